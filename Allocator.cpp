@@ -0,0 +1,36 @@
+#include "Allocator.h"
+
+static thread_local ObjectArena* currentArena = nullptr;
+
+ObjectArena::ObjectArena() : prev(currentArena) {
+    currentArena = this;
+}
+
+ObjectArena::~ObjectArena() {
+    currentArena = prev;
+    for (void* chunk : chunks) {
+        ::operator delete(chunk);
+    }
+}
+
+void* ObjectArena::Allocate(size_t size, size_t align) {
+    char* ptr = (char*)(((size_t)cur + align - 1) & ~(align - 1));
+    if (cur == nullptr || ptr + size > end) {
+        size_t chunkSize = size + align > ChunkSize ? size + align : ChunkSize;
+        cur = (char*)::operator new(chunkSize);
+        end = cur + chunkSize;
+        chunks.push_back(cur);
+        ptr = (char*)(((size_t)cur + align - 1) & ~(align - 1));
+    }
+    cur = ptr + size;
+    used += size;
+    return ptr;
+}
+
+size_t ObjectArena::Used() const {
+    return used;
+}
+
+ObjectArena* ObjectArena::Current() {
+    return currentArena;
+}
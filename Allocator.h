@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Bump allocator for short-lived reflected objects. While an arena is alive it
+// is the current arena of its thread and every ObjectAllocator created there
+// takes memory from it; releasing those objects runs their destructors but
+// the memory only goes back when the arena is destroyed, so nothing allocated
+// inside the scope may outlive it.
+class ObjectArena {
+    private:
+        static constexpr size_t ChunkSize = 64 * 1024;
+        std::vector<void*> chunks;
+        char* cur = nullptr;
+        char* end = nullptr;
+        size_t used = 0;
+        ObjectArena* prev;
+    public:
+        ObjectArena();
+        ~ObjectArena();
+        ObjectArena(const ObjectArena&) = delete;
+        ObjectArena& operator = (const ObjectArena&) = delete;
+        void* Allocate(size_t size, size_t align);
+        size_t Used() const;
+        static ObjectArena* Current();
+};
+
+// Thread-local free list of blocks sized for T. Blocks released on another
+// thread join that thread's list, every list keeps at most MaxCached blocks.
+template<typename T>
+class ObjectPool {
+    private:
+        struct Node {
+            Node* next;
+        };
+        static constexpr size_t BlockSize = sizeof(T) < sizeof(Node) ? sizeof(Node) : sizeof(T);
+        static inline thread_local Node* head = nullptr;
+        static inline thread_local size_t cached = 0;
+        struct Drain {
+            ~Drain() {
+                while (head != nullptr) {
+                    Node* next = head->next;
+                    ::operator delete(head);
+                    head = next;
+                }
+                cached = MaxCached;
+            }
+        };
+        static inline thread_local Drain drain;
+    public:
+        static constexpr size_t MaxCached = 1024;
+        static void* Allocate() {
+            (void)&drain;
+            if (head == nullptr) {
+                return ::operator new(BlockSize);
+            }
+            Node* node = head;
+            head = node->next;
+            cached--;
+            return node;
+        }
+        static void Deallocate(void* ptr) {
+            if (cached >= MaxCached) {
+                ::operator delete(ptr);
+                return;
+            }
+            head = new (ptr) Node{ head };
+            cached++;
+        }
+};
+
+template<typename T>
+struct ObjectAllocator {
+    using value_type = T;
+    ObjectArena* arena = ObjectArena::Current();
+    ObjectAllocator() = default;
+    template<typename U>
+    ObjectAllocator(const ObjectAllocator<U>& other) : arena(other.arena) {}
+    static constexpr bool Pooled = alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+    T* allocate(size_t n) {
+        if (arena != nullptr) {
+            return (T*)arena->Allocate(n * sizeof(T), alignof(T));
+        }
+        if (n == 1 && Pooled) {
+            return (T*)ObjectPool<T>::Allocate();
+        }
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* ptr, size_t n) {
+        if (arena != nullptr) {
+            return;
+        }
+        if (n == 1 && Pooled) {
+            ObjectPool<T>::Deallocate(ptr);
+            return;
+        }
+        std::allocator<T>().deallocate(ptr, n);
+    }
+    template<typename U>
+    bool operator == (const ObjectAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+};
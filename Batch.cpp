@@ -0,0 +1,98 @@
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include "Batch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BATCH_AVX2
+#endif
+
+bool CheckBatchField(const FieldHandle& field, TypeID type, size_t count, size_t size) {
+    if (!field) {
+        std::cerr << "Error: batch access through an invalid field handle" << std::endl;
+        return false;
+    }
+    if (field.GetFieldInfo()->varType.getHash() != type.getHash()) {
+        std::cerr << "Error: field " << field.GetFieldInfo()->name << " is " << field.GetFieldInfo()->varType.getName() << ", not " << type.getName() << std::endl;
+        return false;
+    }
+    if (count != size) {
+        std::cerr << "Error: batch of " << count << " objects but buffer of " << size << " values" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void* FieldAddress(const FieldHandle& field, ObjectPtr object) {
+    if (object.GetType().getHash() == field.GetOwnerType().getHash()) {
+        return field.Get(object).GetRawPtr();
+    }
+    auto ptr = ReflMgr::Instance().RawGetField(object, field.GetFieldInfo()->name);
+    if (ptr.GetRawPtr() != nullptr && ptr.GetType().getHash() != field.GetFieldInfo()->varType.getHash()) {
+        std::cerr << "Error: field " << field.GetFieldInfo()->name << " of " << object.GetType().getName() << " is " << ptr.GetType().getName() << ", not " << field.GetFieldInfo()->varType.getName() << std::endl;
+        return nullptr;
+    }
+    return ptr.GetRawPtr();
+}
+
+template<typename W>
+static void GatherScalar(const char* base, size_t stride, size_t count, W* out) {
+    for (size_t i = 0; i < count; i++) {
+        std::memcpy(out + i, base + i * stride, sizeof(W));
+    }
+}
+
+#ifdef BATCH_AVX2
+__attribute__((target("avx2")))
+static void Gather32AVX2(const char* base, size_t stride, size_t count, uint32_t* out) {
+    const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)stride));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_i32gather_epi32((const int*)(base + i * stride), index, 1);
+        _mm256_storeu_si256((__m256i*)(out + i), v);
+    }
+    GatherScalar(base + i * stride, stride, count - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static void Gather64AVX2(const char* base, size_t stride, size_t count, uint64_t* out) {
+    const __m256i index = _mm256_setr_epi64x(0, stride, 2 * stride, 3 * stride);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_i64gather_epi64((const long long*)(base + i * stride), index, 1);
+        _mm256_storeu_si256((__m256i*)(out + i), v);
+    }
+    GatherScalar(base + i * stride, stride, count - i, out + i);
+}
+
+static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+void GatherStrided(const void* base, size_t stride, size_t count, size_t size, void* out) {
+    const char* src = (const char*)base;
+    switch (size) {
+        case 4:
+#ifdef BATCH_AVX2
+            if (hasAVX2 && stride <= INT_MAX / 8) {
+                Gather32AVX2(src, stride, count, (uint32_t*)out);
+                return;
+            }
+#endif
+            GatherScalar(src, stride, count, (uint32_t*)out);
+            return;
+        case 8:
+#ifdef BATCH_AVX2
+            if (hasAVX2) {
+                Gather64AVX2(src, stride, count, (uint64_t*)out);
+                return;
+            }
+#endif
+            GatherScalar(src, stride, count, (uint64_t*)out);
+            return;
+        default:
+            for (size_t i = 0; i < count; i++) {
+                std::memcpy((char*)out + i * size, src + i * stride, size);
+            }
+    }
+}
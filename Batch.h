@@ -0,0 +1,93 @@
+#pragma once
+#include <span>
+#include <cstring>
+#include <type_traits>
+#include "ReflMgr.h"
+
+// Reads or writes one field of many objects through a FieldHandle. Objects of
+// the handle's owner type are accessed at base + offset; other types (derived
+// classes, fields without an offset) fall back to a lookup per object.
+// Objects without the field are reported and make the call return false;
+// gathering writes T() for them.
+bool CheckBatchField(const FieldHandle& field, TypeID type, size_t count, size_t size);
+void* FieldAddress(const FieldHandle& field, ObjectPtr object);
+// Copies count values of the given size, stride bytes apart, into out. Uses
+// AVX2 gathers for 4 and 8 byte values when the CPU supports them.
+void GatherStrided(const void* base, size_t stride, size_t count, size_t size, void* out);
+
+template<typename T>
+bool GatherField(const FieldHandle& field, std::span<const ObjectPtr> objects, std::span<T> out) {
+    if (!CheckBatchField(field, TypeID::get<T>(), objects.size(), out.size())) {
+        return false;
+    }
+    size_t owner = field.GetOwnerType().getHash();
+    bool found = true;
+    for (size_t i = 0; i < objects.size(); i++) {
+        if (field.HasOffset() && objects[i].GetType().getHash() == owner) {
+            out[i] = *(const T*)((const char*)objects[i].GetRawPtr() + field.GetOffset());
+        } else if (void* ptr = FieldAddress(field, objects[i])) {
+            out[i] = *(const T*)ptr;
+        } else {
+            out[i] = T();
+            found = false;
+        }
+    }
+    return found;
+}
+
+template<typename T>
+bool ScatterField(const FieldHandle& field, std::span<const ObjectPtr> objects, std::span<const T> in) {
+    if (!CheckBatchField(field, TypeID::get<T>(), objects.size(), in.size())) {
+        return false;
+    }
+    size_t owner = field.GetOwnerType().getHash();
+    bool found = true;
+    for (size_t i = 0; i < objects.size(); i++) {
+        if (field.HasOffset() && objects[i].GetType().getHash() == owner) {
+            *(T*)((char*)objects[i].GetRawPtr() + field.GetOffset()) = in[i];
+        } else if (void* ptr = FieldAddress(field, objects[i])) {
+            *(T*)ptr = in[i];
+        } else {
+            found = false;
+        }
+    }
+    return found;
+}
+
+// array points to out.size() objects of the owner type, stride bytes apart
+template<typename T>
+bool GatherField(const FieldHandle& field, const void* array, size_t stride, std::span<T> out) {
+    if (!CheckBatchField(field, TypeID::get<T>(), out.size(), out.size())) {
+        return false;
+    }
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        if (field.HasOffset()) {
+            GatherStrided((const char*)array + field.GetOffset(), stride, out.size(), sizeof(T), out.data());
+            return true;
+        }
+    }
+    for (size_t i = 0; i < out.size(); i++) {
+        out[i] = *(const T*)field.Get((char*)array + i * stride).GetRawPtr();
+    }
+    return true;
+}
+
+template<typename T>
+bool ScatterField(const FieldHandle& field, void* array, size_t stride, std::span<const T> in) {
+    if (!CheckBatchField(field, TypeID::get<T>(), in.size(), in.size())) {
+        return false;
+    }
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        if (field.HasOffset()) {
+            char* base = (char*)array + field.GetOffset();
+            for (size_t i = 0; i < in.size(); i++) {
+                std::memcpy(base + i * stride, &in[i], sizeof(T));
+            }
+            return true;
+        }
+    }
+    for (size_t i = 0; i < in.size(); i++) {
+        *(T*)field.Get((char*)array + i * stride).GetRawPtr() = in[i];
+    }
+    return true;
+}
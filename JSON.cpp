@@ -1,8 +1,17 @@
 #include <sstream>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
 #include "JSON.h"
 #include "ReflMgr.h"
 #include "MetaMethods.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define JSON_SIMD
+#endif
+
 static std::string codeString(std::string_view s) {
     std::string ret = "";
     for (auto ch : s) {
@@ -12,6 +21,9 @@ static std::string codeString(std::string_view s) {
             ret += "\\r";
         } else if (ch == '\t') {
             ret += "\\t";
+        } else if (ch == '"' || ch == '\\') {
+            ret += '\\';
+            ret += ch;
         } else {
             ret += ch;
         }
@@ -19,17 +31,175 @@ static std::string codeString(std::string_view s) {
     return ret;
 }
 
+// Value of a document built by ParseDocument. Strings and children live in
+// the document's arena; an object has 2 * size children, alternating key
+// strings and values in input order.
+struct JSONNode {
+    enum Kind : uint32_t { Null, Int, UInt, Double, String, Array, Object };
+    uint32_t kind = Null;
+    // string length, element count or member count
+    uint32_t size = 0;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char* str;
+        const JSONNode* children;
+    };
+    std::string_view view() const {
+        return { str, size };
+    }
+};
+static_assert(sizeof(JSONNode) == 16);
+
+// Owns every node and string of one document. Nothing in it has a
+// destructor, so releasing the document only frees its chunks.
+struct JSONDocument {
+    static constexpr size_t ChunkSize = 64 * 1024;
+    std::vector<void*> chunks;
+    char* cur = nullptr;
+    char* end = nullptr;
+    JSONNode root;
+    JSONDocument() = default;
+    JSONDocument(const JSONDocument&) = delete;
+    JSONDocument& operator = (const JSONDocument&) = delete;
+    ~JSONDocument() {
+        for (void* chunk : chunks) {
+            ::operator delete(chunk);
+        }
+    }
+    void* allocate(size_t size, size_t align) {
+        char* ptr = (char*)(((size_t)cur + align - 1) & ~(align - 1));
+        if (cur == nullptr || ptr + size > end) {
+            size_t chunkSize = size + align > ChunkSize ? size + align : ChunkSize;
+            cur = (char*)::operator new(chunkSize);
+            end = cur + chunkSize;
+            chunks.push_back(cur);
+            ptr = (char*)(((size_t)cur + align - 1) & ~(align - 1));
+        }
+        cur = ptr + size;
+        return ptr;
+    }
+};
+
+// Numbers become int64_t, uint64_t when they only fit unsigned, and double
+// otherwise. Integers of up to 18 digits cannot overflow and are converted
+// directly.
+static bool parseNumber(std::string_view word, JSONNode& out) {
+    const char* begin = word.data();
+    const char* end = begin + word.size();
+    if (begin != end && *begin == '+') {
+        begin++;
+    }
+    if (begin == end || !(isdigit((unsigned char)*begin) || *begin == '-' || *begin == '.')) {
+        return false;
+    }
+    bool negative = *begin == '-';
+    const char* digits = begin + negative;
+    if (digits != end && end - digits <= 18) {
+        int64_t value = 0;
+        const char* cur = digits;
+        while (cur != end && (unsigned)(*cur - '0') < 10) {
+            value = value * 10 + (*cur++ - '0');
+        }
+        if (cur == end) {
+            out.kind = JSONNode::Int;
+            out.i = negative ? -value : value;
+            return true;
+        }
+    }
+    int64_t i;
+    if (auto [ptr, ec] = std::from_chars(begin, end, i); ec == std::errc() && ptr == end) {
+        out.kind = JSONNode::Int;
+        out.i = i;
+        return true;
+    }
+    uint64_t u;
+    if (auto [ptr, ec] = std::from_chars(begin, end, u); ec == std::errc() && ptr == end) {
+        out.kind = JSONNode::UInt;
+        out.u = u;
+        return true;
+    }
+    double d;
+    // from_chars also reads inf and nan, which JSON has no numbers for
+    if (auto [ptr, ec] = std::from_chars(begin, end, d); ec == std::errc() && ptr == end && std::isfinite(d)) {
+        out.kind = JSONNode::Double;
+        out.d = d;
+        return true;
+    }
+    return false;
+}
+
+static SharedObject scalarValue(const JSONNode& node) {
+    switch (node.kind) {
+        case JSONNode::Int:
+            return SharedObject::New<int64_t>(node.i);
+        case JSONNode::UInt:
+            return SharedObject::New<uint64_t>(node.u);
+        case JSONNode::Double:
+            return SharedObject::New<double>(node.d);
+        case JSONNode::String:
+            return SharedObject::New<std::string>(std::string{node.view()});
+        default:
+            return SharedObject{};
+    }
+}
+
+// bare words that are not numbers are kept as strings
+static SharedObject wordValue(std::string_view word, bool views) {
+    JSONNode number;
+    if (parseNumber(word, number)) {
+        return scalarValue(number);
+    }
+    if (views) {
+        return SharedObject::New<std::string_view>(word);
+    }
+    return SharedObject::New<std::string>(std::string{word});
+}
+
+// shortest text that reads back as the same value; whole floating-point
+// values keep a ".0" so they are parsed as doubles again
+template<typename T>
+static void printChars(std::ostream& out, T value) {
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf) - 2, value);
+    if constexpr (std::is_floating_point_v<T>) {
+        if (std::string_view(buf, res.ptr - buf).find_first_of(".eEna") == std::string_view::npos) {
+            *res.ptr++ = '.';
+            *res.ptr++ = '0';
+        }
+    }
+    out.write(buf, res.ptr - buf);
+}
+
+template<typename T>
+static bool printNumber(std::ostream& out, const T& val) {
+    TypeID type = val.GetType();
+    if (type == TypeID::get<double>()) {
+        printChars(out, val.template Get<double>());
+    } else if (type == TypeID::get<int64_t>()) {
+        printChars(out, val.template Get<int64_t>());
+    } else if (type == TypeID::get<uint64_t>()) {
+        printChars(out, val.template Get<uint64_t>());
+    } else if (type == TypeID::get<float>()) {
+        printChars(out, val.template Get<float>());
+    } else {
+        return false;
+    }
+    return true;
+}
+
 template<typename T>
 static void print(std::stringstream& out, const T& val) {
     if constexpr (std::same_as<T, std::string> || std::same_as<T, std::string_view>) {
-        out << '"' << val << '"';
+        out << '"' << codeString(val) << '"';
     } else {
         if constexpr (std::same_as<T, SharedObject> || std::same_as<T, ObjectPtr>) {
             if (val.GetType() == TypeID::get<std::string>()) {
                 out << '"' << codeString(val.template Get<std::string>()) << '"';
             } else if (val.GetType() == TypeID::get<std::string_view>()) {
                 out << '"' << codeString(val.template Get<std::string_view>()) << '"';
-            } else {
+            } else if (!printNumber(out, val)) {
                 out << val;
             }
         } else {
@@ -42,62 +212,49 @@ static bool useIndent = true;
 static int indentWidth = 4;
 static int indent = 0;
 
-template<typename T>
-static void printVec(std::stringstream& out, T& val) {
+static void printIndent(std::stringstream& out) {
+    for (int i = 0; i < indent * indentWidth; i++) {
+        out << " ";
+    }
+}
+
+// element(i) prints the i-th element
+template<typename Element>
+static void printVec(std::stringstream& out, size_t count, Element element) {
     out << "[";
     indent++;
-    if (val.size() > 0) {
-        print(out, val[0].content());
-        for (int i = 1; i < val.size(); i++) {
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
             out << ", ";
-            print(out, val[i].content());
         }
+        element(i);
     }
     indent--;
     out << "]";
 }
 
-static void printIndent(std::stringstream& out) {
-    for (int i = 0; i < indent * indentWidth; i++) {
-        out << " ";
-    }
-}
-
-template<typename T, typename V>
-static void printMap(std::stringstream& out, std::unordered_map<T, V>& val) {
+// member(i) prints "key: value" of the i-th member
+template<typename Member>
+static void printMap(std::stringstream& out, size_t count, Member member) {
     out << "{";
     if (useIndent) {
         indent++;
     }
-    if (val.size() > 0) {
-        auto iter = val.begin();
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            out << ",";
+        }
         if (useIndent) {
             out << std::endl;
             printIndent(out);
         } else {
             out << " ";
         }
-        print(out, iter->first);
-        out << ": ";
-        print(out, iter->second.content());
-        iter++;
-        while (iter != val.end()) {
-            out << ",";
-            if (useIndent) {
-                out << std::endl;
-                printIndent(out);
-            } else {
-                out << " ";
-            }
-            print(out, iter->first);
-            out << ": ";
-            print(out, iter->second.content());
-            iter++;
-        }
+        member(i);
     }
     if (useIndent) {
         indent--;
-        if (val.size() > 0) {
+        if (count > 0) {
             out << std::endl;
             printIndent(out);
         }
@@ -105,9 +262,68 @@ static void printMap(std::stringstream& out, std::unordered_map<T, V>& val) {
     out << "}";
 }
 
+static void printNode(std::stringstream& out, const JSONNode& node, bool quote) {
+    switch (node.kind) {
+        case JSONNode::Int:
+            printChars(out, node.i);
+            break;
+        case JSONNode::UInt:
+            printChars(out, node.u);
+            break;
+        case JSONNode::Double:
+            printChars(out, node.d);
+            break;
+        case JSONNode::String:
+            if (quote) {
+                out << '"' << codeString(node.view()) << '"';
+            } else {
+                out << node.view();
+            }
+            break;
+        case JSONNode::Array:
+            printVec(out, node.size, [&](size_t i) {
+                printNode(out, node.children[i], true);
+            });
+            break;
+        case JSONNode::Object:
+            printMap(out, node.size, [&](size_t i) {
+                print(out, node.children[2 * i].view());
+                out << ": ";
+                printNode(out, node.children[2 * i + 1], true);
+            });
+            break;
+        default:
+            out << SharedObject::Null;
+    }
+}
+
+static void printItem(std::stringstream& out, JSON& item) {
+    if (auto* node = item.Node()) {
+        printNode(out, *node, true);
+    } else {
+        print(out, item.content());
+    }
+}
+
+static void printVec(std::stringstream& out, std::vector<JSON>& val) {
+    printVec(out, val.size(), [&](size_t i) {
+        printItem(out, val[i]);
+    });
+}
+
+static void printMap(std::stringstream& out, JSON::Map& val) {
+    auto iter = val.begin();
+    printMap(out, val.size(), [&](size_t) {
+        print(out, iter->first);
+        out << ": ";
+        printItem(out, iter->second);
+        iter++;
+    });
+}
+
 JSON JSON::NewMap() {
     JSON ret;
-    ret.obj = SharedObject::New<std::unordered_map<std::string, JSON>>();
+    ret.obj = SharedObject::New<JSON::Map>();
     return ret;
 }
 
@@ -119,44 +335,151 @@ JSON JSON::NewVec() {
 
 void JSON::Init() {
     ReflMgr::Instance().AddMethod<JSON>(std::function([](JSON* self) -> std::string {
-        return self->obj.tostring().As<std::string>();
+        return self->ToString();
     }), MetaMethods::operator_tostring);
     ReflMgr::Instance().AddMethod<std::vector<JSON>>(std::function([](std::vector<JSON>* self) -> std::string {
         std::stringstream ss;
         printVec(ss, *self);
         return ss.str();
     }), MetaMethods::operator_tostring);
-    ReflMgr::Instance().AddMethod<std::unordered_map<std::string, JSON>>(std::function([](std::unordered_map<std::string, JSON>* self) -> std::string {
+    ReflMgr::Instance().AddMethod<JSON::Map>(std::function([](JSON::Map* self) -> std::string {
         std::stringstream ss;
         printMap(ss, *self);
         return ss.str();
     }), MetaMethods::operator_tostring);
 }
 
-JSON::JSON(SharedObject obj) : obj(obj) {}
+JSON::JSON(SharedObject obj) : obj(std::move(obj)) {}
 
 JSON::JSON() {
     obj = SharedObject{ TypeID::get<void>(), nullptr };
 }
 
+const JSONNode* JSON::Node() const {
+    if (obj.GetType() != TypeID::get<JSONNode>()) {
+        return nullptr;
+    }
+    return (const JSONNode*)obj.GetRawPtr();
+}
+
+// obj shares ownership of the document and points at the node
+static JSON nodeRef(const std::shared_ptr<void>& doc, const JSONNode* node) {
+    return JSON{ SharedObject{ TypeID::get<JSONNode>(), std::shared_ptr<void>(doc, (void*)node), false } };
+}
+
 SharedObject& JSON::content() {
+    auto* node = Node();
+    if (node == nullptr) {
+        return obj;
+    }
+    // children stay nodes until they are reached themselves
+    auto doc = obj.GetPtr();
+    if (node->kind == JSONNode::Array) {
+        std::vector<JSON> vec;
+        vec.reserve(node->size);
+        for (size_t i = 0; i < node->size; i++) {
+            vec.push_back(nodeRef(doc, node->children + i));
+        }
+        obj = SharedObject::New<std::vector<JSON>>(std::move(vec));
+    } else if (node->kind == JSONNode::Object) {
+        JSON::Map map;
+        map.reserve(node->size);
+        for (size_t i = 0; i < node->size; i++) {
+            map[std::string{node->children[2 * i].view()}] = nodeRef(doc, node->children + 2 * i + 1);
+        }
+        obj = SharedObject::New<JSON::Map>(std::move(map));
+    } else {
+        obj = scalarValue(*node);
+    }
     return obj;
 }
 
 std::string JSON::ToString() {
     std::stringstream ss;
-    ss << obj;
+    ss << *this;
     return ss.str();
 }
 
-JSON JSON::Parse(std::string_view content) {
-    return JSON{ content };
-}
-
 JSON JSON::ToJson(SharedObject obj) {
     return JSON{ obj };
 }
 
+static void appendUtf8(uint32_t code, std::string& out) {
+    if (code < 0x80) {
+        out.push_back((char)code);
+    } else if (code < 0x800) {
+        out.push_back((char)(0xC0 | code >> 6));
+        out.push_back((char)(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out.push_back((char)(0xE0 | code >> 12));
+        out.push_back((char)(0x80 | (code >> 6 & 0x3F)));
+        out.push_back((char)(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back((char)(0xF0 | code >> 18));
+        out.push_back((char)(0x80 | (code >> 12 & 0x3F)));
+        out.push_back((char)(0x80 | (code >> 6 & 0x3F)));
+        out.push_back((char)(0x80 | (code & 0x3F)));
+    }
+}
+
+// reads the 4 hex digits after \u at raw[pos], returns false if they are not there
+static bool readHex4(std::string_view raw, size_t pos, uint32_t& code) {
+    if (pos + 4 > raw.size()) {
+        return false;
+    }
+    code = 0;
+    for (size_t i = pos; i < pos + 4; i++) {
+        char ch = raw[i];
+        uint32_t digit;
+        if (ch >= '0' && ch <= '9') {
+            digit = ch - '0';
+        } else if (ch >= 'a' && ch <= 'f') {
+            digit = ch - 'a' + 10;
+        } else if (ch >= 'A' && ch <= 'F') {
+            digit = ch - 'A' + 10;
+        } else {
+            return false;
+        }
+        code = code << 4 | digit;
+    }
+    return true;
+}
+
+// the only place escapes are decoded. \uXXXX becomes
+// UTF-8, a surrogate pair is joined, and any other escaped character (or a
+// malformed \u) is kept as it is
+static void unescape(std::string_view raw, std::string& out) {
+    out.clear();
+    for (size_t i = 0; i < raw.size(); i++) {
+        char ch = raw[i];
+        if (ch == '\\' && i + 1 < raw.size()) {
+            ch = raw[++i];
+            if (ch == 'n') {
+                ch = '\n';
+            } else if (ch == 'r') {
+                ch = '\r';
+            } else if (ch == 't') {
+                ch = '\t';
+            } else if (ch == 'b') {
+                ch = '\b';
+            } else if (ch == 'f') {
+                ch = '\f';
+            } else if (uint32_t code; ch == 'u' && readHex4(raw, i + 1, code)) {
+                i += 4;
+                uint32_t low;
+                if (code >= 0xD800 && code < 0xDC00 && i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u'
+                    && readHex4(raw, i + 3, low) && low >= 0xDC00 && low < 0xE000) {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+                appendUtf8(code, out);
+                continue;
+            }
+        }
+        out.push_back(ch);
+    }
+}
+
 struct Tokenizer {
     std::istream& in;
     Tokenizer(std::istream& in) : in(in) {}
@@ -197,46 +520,28 @@ struct Tokenizer {
         if (ch == '"') {
             content = "";
             ch = getChar();
-            while (ch != '"') {
+            std::string raw;
+            while (ch != '"' && ch != EOF) {
                 if (ch == '\\') {
+                    raw.push_back(ch);
                     ch = getChar();
-                    if (ch == 'n') {
-                        ch = '\n';
-                    } else if (ch == 'r') {
-                        ch = '\r';
-                    } else if (ch == 't') {
-                        ch = '\t';
+                    if (ch == EOF) {
+                        break;
                     }
                 }
-                content.push_back(ch);
+                raw.push_back(ch);
                 ch = getChar();
             }
+            unescape(raw, content);
             return { TypeID::get<std::string>(), content };
         } else if (isdigit(ch) || isalpha(ch) || ch == '-' || ch == '+' || ch == '.') {
-            bool hasAlpha = isalpha(ch);
-            bool hasDot = ch == '.';
             ch = getChar();
             while (isdigit(ch) || isalpha(ch) || ch == '-' || ch == '+' || ch == '.') {
-                if (isalpha(ch)) {
-                    hasAlpha = true;
-                }
-                if (ch == '.') {
-                    if (hasDot) {
-                        hasAlpha = true;
-                    }
-                    hasDot = true;
-                }
                 content.push_back(ch);
                 ch = getChar();
             }
             backChar(ch);
-            if (hasAlpha) {
-                return { TypeID::get<std::string>(), content };
-            } else if (hasDot) {
-                return { TypeID::get<float>(), content };
-            } else {
-                return { TypeID::get<int>(), content };
-            }
+            return { TypeID::get<std::string_view>(), content };
         } else {
             return { TypeID::get<void>(), content };
         }
@@ -253,19 +558,10 @@ struct Tokenizer {
     }
 };
 
-template<typename T, typename U>
-T ConvertTo(U orig) {
-    std::stringstream ss;
-    ss << orig;
-    T ret;
-    ss >> ret;
-    return ret;
-}
-
 SharedObject parse(Tokenizer& tk) {
     auto token = tk.getToken();
     if (token == Tokenizer::symbol('{')) {
-        auto obj = std::unordered_map<std::string, JSON>();
+        auto obj = JSON::Map();
         token = tk.getToken();
         while (token != Tokenizer::symbol('}')) {
             auto key = token.second;
@@ -294,10 +590,8 @@ SharedObject parse(Tokenizer& tk) {
             token = tk.getToken();
         }
         return SharedObject::New<decltype(vec)>(vec);
-    } else if (token.first == TypeID::get<int>()) {
-        return SharedObject::New<int>(ConvertTo<int>(token.second));
-    } else if (token.first == TypeID::get<float>()) {
-        return SharedObject::New<float>(ConvertTo<float>(token.second));
+    } else if (token.first == TypeID::get<std::string_view>()) {
+        return wordValue(token.second, false);
     } else if (token.first == TypeID::get<std::string>()) {
         return SharedObject::New<std::string>(token.second);
     } else {
@@ -306,11 +600,455 @@ SharedObject parse(Tokenizer& tk) {
     return SharedObject::Null;
 }
 
+static bool isWordChar(char ch) {
+    return isdigit((unsigned char)ch) || isalpha((unsigned char)ch) || ch == '-' || ch == '+' || ch == '.';
+}
+
+// Token source over a contiguous buffer, scanning with pointers instead of
+// pulling characters out of a stream.
+struct BufferTokens {
+    const char* cur;
+    const char* end;
+    BufferTokens(std::string_view content) : cur(content.data()), end(content.data() + content.size()) {}
+    void skipSpace() {
+        while (cur < end && (*cur == ' ' || *cur == '\n' || *cur == '\r' || *cur == '\t')) {
+            cur++;
+        }
+    }
+    bool atEnd() {
+        skipSpace();
+        return cur == end;
+    }
+    char peek() const {
+        return *cur;
+    }
+    void skip() {
+        cur++;
+    }
+    bool trySymbol(char ch) {
+        skipSpace();
+        if (cur < end && *cur == ch) {
+            cur++;
+            return true;
+        }
+        return false;
+    }
+    std::string_view found() const {
+        return cur < end ? std::string_view(cur, 1) : "";
+    }
+    // cur is at the opening quote; unescaped content is left in buffer when
+    // the string has escapes, otherwise the returned view points at the input
+    std::string_view scanString(std::string& buffer) {
+        const char* begin = ++cur;
+        const char* quote;
+        for (const char* from = begin;; from = quote + 1) {
+            quote = (const char*)memchr(from, '"', end - from);
+            if (quote == nullptr) {
+                break;
+            }
+            // a quote is escaped if an odd number of backslashes come before it
+            const char* slash = quote;
+            while (slash > begin && slash[-1] == '\\') {
+                slash--;
+            }
+            if ((quote - slash) % 2 == 0) {
+                break;
+            }
+        }
+        const char* limit = quote == nullptr ? end : quote;
+        cur = quote == nullptr ? end : quote + 1;
+        std::string_view raw{ begin, (size_t)(limit - begin) };
+        if (memchr(begin, '\\', limit - begin) == nullptr) {
+            return raw;
+        }
+        unescape(raw, buffer);
+        return buffer;
+    }
+    std::string_view scanWord() {
+        const char* begin = cur;
+        while (cur < end && isWordChar(*cur)) {
+            cur++;
+        }
+        return { begin, (size_t)(cur - begin) };
+    }
+    std::string_view scanKey(std::string& buffer) {
+        skipSpace();
+        if (cur < end && *cur == '"') {
+            return scanString(buffer);
+        }
+        if (cur < end && isWordChar(*cur)) {
+            return scanWord();
+        }
+        if (cur == end) {
+            return {};
+        }
+        return { cur++, 1 };
+    }
+};
+
+// Builds JSON values. With views set, strings without escapes are kept as
+// string_view into the input, which then has to outlive the result.
+struct ValueBuilder {
+    using Value = SharedObject;
+    struct Object {
+        JSON::Map map;
+        std::string key;
+    };
+    using Array = std::vector<JSON>;
+    bool views;
+    Value null() {
+        return SharedObject::Null;
+    }
+    Value string(std::string_view str, bool escaped) {
+        if (views && !escaped) {
+            return SharedObject::New<std::string_view>(str);
+        }
+        return SharedObject::New<std::string>(std::string{str});
+    }
+    Value word(std::string_view word) {
+        return wordValue(word, views);
+    }
+    Object beginObject() {
+        return {};
+    }
+    void key(Object& obj, std::string_view key) {
+        obj.key = key;
+    }
+    void member(Object& obj, Value value) {
+        obj.map[std::move(obj.key)] = JSON{std::move(value)};
+    }
+    Value endObject(Object& obj) {
+        return SharedObject::New<JSON::Map>(std::move(obj.map));
+    }
+    Array beginArray() {
+        return {};
+    }
+    void element(Array& vec, Value value) {
+        vec.push_back(JSON{std::move(value)});
+    }
+    Value endArray(Array& vec) {
+        return SharedObject::New<Array>(std::move(vec));
+    }
+};
+
+// Builds a JSONDocument. Children are collected on a shared stack and
+// copied into the arena as one block once their container is closed.
+struct DocumentBuilder {
+    using Value = JSONNode;
+    struct Container {
+        size_t base;
+        size_t size;
+    };
+    using Object = Container;
+    using Array = Container;
+    JSONDocument& doc;
+    std::vector<JSONNode> stack;
+    Value null() {
+        return {};
+    }
+    Value string(std::string_view str, bool = false) {
+        JSONNode node;
+        node.kind = JSONNode::String;
+        node.size = str.size();
+        char* data = (char*)doc.allocate(str.size(), 1);
+        memcpy(data, str.data(), str.size());
+        node.str = data;
+        return node;
+    }
+    Value word(std::string_view word) {
+        JSONNode number;
+        if (parseNumber(word, number)) {
+            return number;
+        }
+        return string(word);
+    }
+    Container beginObject() {
+        return { stack.size(), 0 };
+    }
+    void key(Container&, std::string_view key) {
+        stack.push_back(string(key));
+    }
+    void member(Container& obj, Value value) {
+        stack.push_back(value);
+        obj.size++;
+    }
+    Value endObject(Container& obj) {
+        return endContainer(JSONNode::Object, obj);
+    }
+    Container beginArray() {
+        return { stack.size(), 0 };
+    }
+    void element(Container& vec, Value value) {
+        member(vec, value);
+    }
+    Value endArray(Container& vec) {
+        return endContainer(JSONNode::Array, vec);
+    }
+    Value endContainer(uint32_t kind, const Container& c) {
+        JSONNode node;
+        node.kind = kind;
+        node.size = c.size;
+        size_t count = stack.size() - c.base;
+        auto* children = (JSONNode*)doc.allocate(count * sizeof(JSONNode), alignof(JSONNode));
+        std::copy(stack.begin() + c.base, stack.end(), children);
+        stack.resize(c.base);
+        node.children = children;
+        return node;
+    }
+};
+
+// The grammar and its error handling, shared by every token source
+// (BufferTokens, IndexedTokens) and every result (ValueBuilder,
+// DocumentBuilder).
+template <typename Tokens, typename Builder>
+struct ValueParser {
+    using Value = typename Builder::Value;
+    Tokens tokens;
+    Builder builder;
+    void expectSymbol(char ch) {
+        if (!tokens.trySymbol(ch)) {
+            std::cerr << "Error when parsing JSON: expecting " << ch << ", but " << tokens.found() << " found." << std::endl;
+        }
+    }
+    Value parseValue() {
+        if (tokens.atEnd()) {
+            std::cerr << "Error when parsing JSON: unexpected end of input" << std::endl;
+            return builder.null();
+        }
+        std::string buffer;
+        char ch = tokens.peek();
+        if (ch == '{') {
+            tokens.skip();
+            auto obj = builder.beginObject();
+            while (!tokens.trySymbol('}')) {
+                if (tokens.atEnd()) {
+                    std::cerr << "Error when parsing JSON: expecting }, but end of input found." << std::endl;
+                    break;
+                }
+                builder.key(obj, tokens.scanKey(buffer));
+                expectSymbol(':');
+                builder.member(obj, parseValue());
+                if (!tokens.trySymbol(',')) {
+                    expectSymbol('}');
+                    break;
+                }
+            }
+            return builder.endObject(obj);
+        } else if (ch == '[') {
+            tokens.skip();
+            auto vec = builder.beginArray();
+            while (!tokens.trySymbol(']')) {
+                if (tokens.atEnd()) {
+                    std::cerr << "Error when parsing JSON: expecting ], but end of input found." << std::endl;
+                    break;
+                }
+                builder.element(vec, parseValue());
+                if (!tokens.trySymbol(',')) {
+                    expectSymbol(']');
+                    break;
+                }
+            }
+            return builder.endArray(vec);
+        } else if (ch == '"') {
+            auto str = tokens.scanString(buffer);
+            return builder.string(str, str.data() == buffer.data());
+        } else if (isWordChar(ch)) {
+            return builder.word(tokens.scanWord());
+        }
+        std::cerr << "Error when parsing JSON: unknown token: type = " << TypeID::get<void>().getName() << ", content = " << ch << std::endl;
+        tokens.skip();
+        return builder.null();
+    }
+};
+
+// Two stage parser. Stage one classifies 64 byte blocks at once (SSE2 or
+// AVX2 where available) and records the offset of every structural character
+// outside of strings, every unescaped quote and the first character of every
+// bare word. Stage two builds the value tree by walking those offsets, so it
+// never looks at the bytes between them except to copy strings and numbers.
+struct BlockMasks {
+    uint64_t quote = 0, backslash = 0, structural = 0, space = 0;
+};
+
+static void classifyScalar(const char* block, BlockMasks& m) {
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        switch (block[i]) {
+            case '"': m.quote |= bit; break;
+            case '\\': m.backslash |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',': m.structural |= bit; break;
+            case ' ': case '\t': case '\n': case '\r': m.space |= bit; break;
+        }
+    }
+}
+
+#ifdef JSON_SIMD
+__attribute__((target("sse2")))
+static void classifySSE2(const char* block, BlockMasks& m) {
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+        auto eq = [v](char ch) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(ch)); };
+        __m128i structural = _mm_or_si128(_mm_or_si128(_mm_or_si128(eq('{'), eq('}')), _mm_or_si128(eq('['), eq(']'))), _mm_or_si128(eq(':'), eq(',')));
+        __m128i space = _mm_or_si128(_mm_or_si128(eq(' '), eq('\t')), _mm_or_si128(eq('\n'), eq('\r')));
+        m.quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(eq('"')) << (16 * i);
+        m.backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(eq('\\')) << (16 * i);
+        m.structural |= (uint64_t)(uint16_t)_mm_movemask_epi8(structural) << (16 * i);
+        m.space |= (uint64_t)(uint16_t)_mm_movemask_epi8(space) << (16 * i);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i eq256(__m256i v, char ch) {
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(ch));
+}
+
+__attribute__((target("avx2")))
+static void classifyAVX2(const char* block, BlockMasks& m) {
+    for (int i = 0; i < 2; i++) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(block + 32 * i));
+        __m256i structural = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(eq256(v, '{'), eq256(v, '}')), _mm256_or_si256(eq256(v, '['), eq256(v, ']'))), _mm256_or_si256(eq256(v, ':'), eq256(v, ',')));
+        __m256i space = _mm256_or_si256(_mm256_or_si256(eq256(v, ' '), eq256(v, '\t')), _mm256_or_si256(eq256(v, '\n'), eq256(v, '\r')));
+        m.quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(eq256(v, '"')) << (32 * i);
+        m.backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(eq256(v, '\\')) << (32 * i);
+        m.structural |= (uint64_t)(uint32_t)_mm256_movemask_epi8(structural) << (32 * i);
+        m.space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(space) << (32 * i);
+    }
+}
+
+static const auto classifyBlock = __builtin_cpu_supports("avx2") ? classifyAVX2 : __builtin_cpu_supports("sse2") ? classifySSE2 : classifyScalar;
+#else
+static const auto classifyBlock = classifyScalar;
+#endif
+
+// offsets are 32 bit, so the input has to stay below 4GB
+static std::vector<uint32_t> structuralIndex(std::string_view content) {
+    std::vector<uint32_t> index;
+    index.reserve(content.size() / 4 + 1);
+    uint64_t escapeCarry = 0, stringCarry = 0, wordCarry = 0;
+    char tail[64];
+    for (size_t base = 0; base < content.size(); base += 64) {
+        const char* block = content.data() + base;
+        if (content.size() - base < 64) {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, content.size() - base);
+            block = tail;
+        }
+        BlockMasks m;
+        classifyBlock(block, m);
+        // a backslash escapes the next character unless it is escaped itself
+        uint64_t escaped = escapeCarry;
+        uint64_t backslash = m.backslash & ~escapeCarry;
+        escapeCarry = 0;
+        while (backslash) {
+            uint64_t bit = backslash & -backslash;
+            if (bit >> 63) {
+                escapeCarry = 1;
+            }
+            escaped |= bit << 1;
+            backslash &= ~(bit | bit << 1);
+        }
+        uint64_t quote = m.quote & ~escaped;
+        // prefix xor: bit i is set if an odd number of quotes come before or at i
+        uint64_t inString = quote;
+        for (int shift = 1; shift < 64; shift <<= 1) {
+            inString ^= inString << shift;
+        }
+        inString ^= stringCarry;
+        stringCarry = (uint64_t)((int64_t)inString >> 63);
+        uint64_t other = ~(m.quote | m.structural | m.space | inString);
+        uint64_t wordStart = other & ~(other << 1 | wordCarry);
+        wordCarry = other >> 63;
+        uint64_t bits = (m.structural & ~inString) | quote | wordStart;
+        while (bits) {
+            index.push_back((uint32_t)(base + __builtin_ctzll(bits)));
+            bits &= bits - 1;
+        }
+    }
+    return index;
+}
+
+// Token source walking the offsets of structuralIndex. Whitespace is never
+// indexed, so there is nothing to skip.
+struct IndexedTokens {
+    std::string_view content;
+    const uint32_t* cur;
+    const uint32_t* end;
+    IndexedTokens(std::string_view content, const std::vector<uint32_t>& index) : content(content), cur(index.data()), end(index.data() + index.size()) {}
+    bool atEnd() const {
+        return cur == end;
+    }
+    char peek() const {
+        return content[*cur];
+    }
+    void skip() {
+        cur++;
+    }
+    bool trySymbol(char ch) {
+        if (cur < end && content[*cur] == ch) {
+            cur++;
+            return true;
+        }
+        return false;
+    }
+    std::string_view found() const {
+        return cur < end ? content.substr(*cur, 1) : "";
+    }
+    // cur is at the opening quote, the closing one is the next entry
+    std::string_view scanString(std::string& buffer) {
+        size_t begin = *cur++ + 1;
+        size_t close = cur < end ? *cur++ : content.size();
+        auto raw = content.substr(begin, close - begin);
+        if (raw.find('\\') == std::string_view::npos) {
+            return raw;
+        }
+        unescape(raw, buffer);
+        return buffer;
+    }
+    std::string_view scanWord() {
+        size_t begin = *cur++, pos = begin;
+        while (pos < content.size() && isWordChar(content[pos])) {
+            pos++;
+        }
+        return content.substr(begin, pos - begin);
+    }
+    std::string_view scanKey(std::string& buffer) {
+        if (cur < end && content[*cur] == '"') {
+            return scanString(buffer);
+        }
+        if (cur < end && isWordChar(content[*cur])) {
+            return scanWord();
+        }
+        return cur < end ? content.substr(*cur++, 1) : "";
+    }
+};
+
+static SharedObject parseBuffer(std::string_view content, JSON::ParseMode mode, bool views) {
+    if (mode == JSON::ParseMode::Indexed && content.size() < UINT32_MAX) {
+        auto index = structuralIndex(content);
+        ValueParser<IndexedTokens, ValueBuilder> parser{ { content, index }, { views } };
+        return parser.parseValue();
+    }
+    ValueParser<BufferTokens, ValueBuilder> parser{ { content }, { views } };
+    return parser.parseValue();
+}
+
 JSON::JSON(std::string_view content) {
-    std::stringstream ss;
-    ss << content;
-    Tokenizer tk(ss);
-    obj = parse(tk);
+    obj = parseBuffer(content, ParseMode::Scan, false);
+}
+
+JSON JSON::Parse(std::string_view content, ParseMode mode) {
+    return JSON{ parseBuffer(content, mode, false) };
+}
+
+JSON JSON::ParseView(std::string_view content, ParseMode mode) {
+    return JSON{ parseBuffer(content, mode, true) };
+}
+
+JSON JSON::ParseDocument(std::string_view content) {
+    auto doc = std::make_shared<JSONDocument>();
+    ValueParser<BufferTokens, DocumentBuilder> parser{ { content }, { *doc } };
+    doc->root = parser.parseValue();
+    return nodeRef(doc, &doc->root);
 }
 
 std::istream& operator >> (std::istream& in, JSON& obj) {
@@ -320,37 +1058,65 @@ std::istream& operator >> (std::istream& in, JSON& obj) {
 }
 
 std::ostream& operator << (std::ostream& out, const JSON& obj) {
-    out << obj.obj;
+    if (auto* node = obj.Node()) {
+        std::stringstream ss;
+        printNode(ss, *node, false);
+        out << ss.rdbuf();
+    } else if (!printNumber(out, obj.obj)) {
+        out << obj.obj;
+    }
     return out;
 }
 
 int JSON::VecSize() {
+    if (auto* node = Node()) {
+        return node->size;
+    }
     return obj.As<std::vector<JSON>>().size();
 }
 
 int JSON::MapSize() {
-    return obj.As<std::unordered_map<std::string, JSON>>().size();
+    if (auto* node = Node()) {
+        return node->size;
+    }
+    return obj.As<JSON::Map>().size();
 }
 
 bool JSON::HasKey(const std::string& idx) {
-    auto& m = obj.As<std::unordered_map<std::string, JSON>>();
+    if (auto* node = Node()) {
+        for (size_t i = 0; i < node->size; i++) {
+            if (node->children[2 * i].view() == idx) {
+                return true;
+            }
+        }
+        return false;
+    }
+    auto& m = obj.As<JSON::Map>();
     return m.find(idx) != m.end();
 }
 
 bool JSON::HasKey(int idx) {
+    if (auto* node = Node()) {
+        return idx < (int)node->size && idx > 0;
+    }
     return idx < obj.As<std::vector<JSON>>().size() && idx > 0;
 }
 
 JSON& JSON::operator[] (std::string_view idx) {
-    return obj.As<std::unordered_map<std::string, JSON>>()[(std::string)idx];
+    auto& m = content().As<JSON::Map>();
+    auto iter = m.find(idx);
+    if (iter != m.end()) {
+        return iter->second;
+    }
+    return m[(std::string)idx];
 }
 
 JSON& JSON::operator[] (int idx) {
-    return obj.As<std::vector<JSON>>()[idx];
+    return content().As<std::vector<JSON>>()[idx];
 }
 
 JSON& JSON::operator = (int value) {
-    obj = SharedObject::New<int>(value);
+    obj = SharedObject::New<int64_t>(value);
     return *this;
 }
 
@@ -365,22 +1131,22 @@ JSON& JSON::operator = (const JSON& other) {
 }
 
 void JSON::AddItem(JSON item) {
-    obj.As<std::vector<JSON>>().push_back(item);
+    content().As<std::vector<JSON>>().push_back(item);
 }
 
 void JSON::AddItem(std::string key, JSON item) {
-    obj.As<std::unordered_map<std::string, JSON>>()[key] = item;
+    content().As<JSON::Map>()[key] = item;
 }
 
 void JSON::Foreach(std::function<void(std::string_view key, JSON& item)> call) {
-    auto& m = obj.As<std::unordered_map<std::string, JSON>>();
+    auto& m = content().As<JSON::Map>();
     for (auto& p : m) {
         call(p.first, p.second);
     }
 }
 
 void JSON::Foreach(std::function<void(int idx, JSON& item)> call) {
-    auto& m = obj.As<std::vector<JSON>>();
+    auto& m = content().As<std::vector<JSON>>();
     for (int idx = 0; idx < m.size(); idx++) {
         call(idx, m[idx]);
     }
@@ -389,10 +1155,10 @@ void JSON::Foreach(std::function<void(int idx, JSON& item)> call) {
 void Foreach(std::function<void(int idx, JSON& item)> call);
 
 void JSON::RemoveItem(int pos) {
-    auto& vec = obj.As<std::vector<JSON>>();
+    auto& vec = content().As<std::vector<JSON>>();
     vec.erase(vec.begin() + pos);
 }
 
 void JSON::RemoveItem(std::string key) {
-    obj.As<std::unordered_map<std::string, JSON>>().erase(key);
+    content().As<JSON::Map>().erase(key);
 }
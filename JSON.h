@@ -2,14 +2,26 @@
 
 #include "Object.h"
 
+struct JSONNode;
+
+struct JSONKeyHash {
+    using is_transparent = void;
+    size_t operator() (std::string_view key) const {
+        return std::hash<std::string_view>()(key);
+    }
+};
+
 class JSON {
     private:
         SharedObject obj;
     public:
+        using Map = std::unordered_map<std::string, JSON, JSONKeyHash, std::equal_to<>>;
         static void Init();
         SharedObject& content();
         JSON();
         explicit JSON(SharedObject obj);
+        JSON(const JSON& other) = default;
+        JSON(JSON&& other) = default;
         JSON(std::string_view cotent);
         std::string ToString();
         void AddItem(JSON item);
@@ -18,7 +30,18 @@ class JSON {
         void Foreach(std::function<void(int idx, JSON& item)> call);
         void RemoveItem(int pos);
         void RemoveItem(std::string key);
-        static JSON Parse(std::string_view content);
+        // Scan walks the text once; Indexed first builds a SIMD structural index
+        enum class ParseMode { Scan, Indexed };
+        static JSON Parse(std::string_view content, ParseMode mode = ParseMode::Scan);
+        // strings without escapes reference content, which must outlive the result
+        static JSON ParseView(std::string_view content, ParseMode mode = ParseMode::Scan);
+        // Compact form: every value is a 16 byte node in an arena owned by the
+        // document, and dropping the last reference frees it in a few calls.
+        // Printing, sizes and HasKey read the nodes directly; content() and
+        // the accessors that return references convert one level at a time.
+        static JSON ParseDocument(std::string_view content);
+        // the node while the value has not been converted, otherwise nullptr
+        const JSONNode* Node() const;
         static JSON ToJson(SharedObject obj);
         static JSON NewMap();
         static JSON NewVec();
@@ -33,4 +56,5 @@ class JSON {
         JSON& operator = (int value);
         JSON& operator = (std::string_view value);
         JSON& operator = (const JSON& other);
+        JSON& operator = (JSON&& other) = default;
 };
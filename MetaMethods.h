@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <iterator>
 #include <string_view>
 #include <type_traits>
 #include <iostream>
@@ -39,6 +40,21 @@ namespace MetaMethods {
     template<typename T> concept has_operator_dec_post = requires(T a) { a--; };
     DEFOP(tostring); template<typename T> concept has_operator_tostring = requires(T a, std::ostream b) { b << a; };
     DEFOP(assign); template<typename T> concept has_operator_assign = requires(T a, T b) { a = b; };
+    enum class Op : unsigned char {
+        add, sub, mul, div, mod, pow, eq, ne, lt, le, gt, ge, unm, index, call,
+        ctor, dtor, begin, end, indirection, inc, dec, tostring, assign, Count
+    };
+    static constexpr std::string_view opNames[] = {
+        operator_add, operator_sub, operator_mul, operator_div, operator_mod, operator_pow,
+        operator_eq, operator_ne, operator_lt, operator_le, operator_gt, operator_ge,
+        operator_unm, operator_index, operator_call, operator_ctor, operator_dtor,
+        operator_begin, operator_end, operator_indirection, operator_inc, operator_dec,
+        operator_tostring, operator_assign
+    };
+    static_assert(std::size(opNames) == (size_t)Op::Count);
+    constexpr std::string_view OpName(Op op) {
+        return opNames[(size_t)op];
+    }
 #undef DEFMULTI
 #undef DEFDOUBLE
 #undef DEFSINGLE
@@ -1,3 +1,4 @@
+#include <cstring>
 #include "ReflMgr.h"
 #include "Object.h"
 
@@ -52,6 +53,10 @@ ObjectPtr ObjectPtr::GetField(std::string_view name) const {
     return ReflMgr::Instance().GetField(*this, name);
 }
 
+ObjectPtr ObjectPtr::GetField(Symbol name) const {
+    return ReflMgr::Instance().GetField(*this, name);
+}
+
 SharedObject ObjectPtr::Invoke(std::string_view method, const std::vector<ObjectPtr>& params) const {
     return ReflMgr::Instance().Invoke(*this, method, params);
 }
@@ -60,8 +65,35 @@ SharedObject ObjectPtr::TryInvoke(std::string_view method, const std::vector<Obj
     return ReflMgr::Instance().Invoke(*this, method, params, false);
 }
 
+SharedObject ObjectPtr::Invoke(InvokeCache& cache, const std::vector<ObjectPtr>& params) const {
+    return cache.Invoke(*this, params);
+}
+
+SharedObject ObjectPtr::Invoke(Symbol method, const std::vector<ObjectPtr>& params) const {
+    return ReflMgr::Instance().Invoke(*this, method, params);
+}
+
 SharedObject::SharedObject() : id(TypeID::get<void>()), ptr(nullptr), objPtr(nullptr) {};
-SharedObject::SharedObject(const SharedObject& other) : id(other.id), ptr(other.ptr), objPtr(other.objPtr) {}
+SharedObject::SharedObject(const SharedObject& other) : id(other.id), ptr(other.ptr), objPtr(other.objPtr), inlined(other.inlined) {
+    std::memcpy(local, other.local, sizeof(local));
+}
+// a moved-from object keeps its reference, as copies did before moves existed
+SharedObject::SharedObject(SharedObject&& other) noexcept : SharedObject(std::as_const(other)) {}
+SharedObject& SharedObject::operator = (const SharedObject& other) {
+    if (this != &other) {
+        Release();
+        id = other.id;
+        ptr = other.ptr;
+        objPtr = other.objPtr;
+        inlined = other.inlined;
+        std::memcpy(local, other.local, sizeof(local));
+    }
+    return *this;
+}
+SharedObject& SharedObject::operator = (SharedObject&& other) noexcept {
+    return *this = std::as_const(other);
+}
+
 SharedObject::SharedObject(TypeID id, void* objPtr) : id(id), objPtr(objPtr) {}
 SharedObject::SharedObject(TypeID id, std::shared_ptr<void> ptr, bool call_ctor) : id(id), ptr(ptr), objPtr(nullptr) {
     if (id == TypeID::get<void>()) {
@@ -77,14 +109,27 @@ TypeID SharedObject::GetType() const {
 }
 
 std::shared_ptr<void> SharedObject::GetPtr() const {
+    if (inlined) {
+        // an inline value has no owner to share; hand out a copy
+        auto slot = std::allocate_shared<Slot>(ObjectAllocator<Slot>());
+        std::memcpy(slot->data, local, sizeof(local));
+        return slot;
+    }
     return ptr;
 }
 
 bool SharedObject::isObjectPtr() const {
-    return objPtr != nullptr;
+    return !inlined && objPtr != nullptr;
+}
+
+bool SharedObject::isInline() const {
+    return inlined;
 }
 
 void* SharedObject::GetRawPtr() const {
+    if (inlined) {
+        return (void*)local;
+    }
     if (isObjectPtr()) {
         return objPtr;
     }
@@ -95,6 +140,10 @@ ObjectPtr SharedObject::GetField(std::string_view name) const {
     return ReflMgr::Instance().GetField(*this, name);
 }
 
+ObjectPtr SharedObject::GetField(Symbol name) const {
+    return ReflMgr::Instance().GetField(*this, name);
+}
+
 SharedObject SharedObject::Invoke(std::string_view method, const std::vector<ObjectPtr>& params) const {
     return ReflMgr::Instance().Invoke(*this, method, params);
 }
@@ -103,11 +152,16 @@ SharedObject SharedObject::TryInvoke(std::string_view method, const std::vector<
     return ReflMgr::Instance().Invoke(*this, method, params, false);
 }
 
+SharedObject SharedObject::Invoke(InvokeCache& cache, const std::vector<ObjectPtr>& params) const {
+    return cache.Invoke(*this, params);
+}
+
+SharedObject SharedObject::Invoke(Symbol method, const std::vector<ObjectPtr>& params) const {
+    return ReflMgr::Instance().Invoke(*this, method, params);
+}
+
 ObjectPtr SharedObject::ToObjectPtr() const {
-    if (isObjectPtr()) {
-        return ObjectPtr{ id, objPtr };
-    }
-    return ObjectPtr{ id, ptr.get() };
+    return ObjectPtr{ id, GetRawPtr() };
 }
 
 #define DEFOPS(T)               \
@@ -124,56 +178,56 @@ ObjectPtr SharedObject::ToObjectPtr() const {
     BIDEF(T, >, gt)             \
     BIDEF(T, >=, ge)            \
     SharedObject T::operator - () const {                                                               \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_unm, {});                    \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::unm, {});                     \
     }                                                                                                   \
     SharedObject T::operator [] (ObjectPtr idx) const {                                                 \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_index, { idx });             \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::index, { &idx, 1 });          \
     }                                                                                                   \
     SharedObject T::operator () (const std::vector<ObjectPtr>& args) const {                            \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_call, args);                 \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::call, args);                  \
     }                                                                                                   \
     SharedObject T::tostring() const {                                                                  \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_tostring, {});               \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::tostring, {});                \
     }                                                                                                   \
     void T::ctor(const std::vector<ObjectPtr>& args) const {                                            \
-        ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_ctor, args, false);                 \
+        ReflMgr::Instance().Construct(*this, args);                                                     \
     }                                                                                                   \
     void T::dtor() const {                                                                              \
-        ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_dtor, {}, false);                   \
+        ReflMgr::Instance().Destruct(*this);                                                            \
     }                                                                                                   \
     SharedObject T::begin() {                                                                           \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_begin, {});                  \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::begin, {});                   \
     }                                                                                                   \
     SharedObject T::end() {                                                                             \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_end, {});                    \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::end, {});                     \
     }                                                                                                   \
     SharedObject T::operator ++ () {                                                                    \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_inc, {});                    \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::inc, {});                     \
     }                                                                                                   \
     SharedObject T::operator -- () {                                                                    \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_dec, {});                    \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::dec, {});                     \
     }                                                                                                   \
     SharedObject T::operator ++ (int) {                                                                 \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_inc,                         \
-            { SharedObject::New<int>() }                                                                \
-        );                                                                                              \
+        auto tag = SharedObject::New<int>();                                                            \
+        ObjectPtr arg = tag;                                                                            \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::inc, { &arg, 1 });            \
     }                                                                                                   \
     SharedObject T::operator -- (int) {                                                                 \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_dec,                         \
-            { SharedObject::New<int>() }                                                                \
-        );                                                                                              \
+        auto tag = SharedObject::New<int>();                                                            \
+        ObjectPtr arg = tag;                                                                            \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::dec, { &arg, 1 });            \
     }                                                                                                   \
     SharedObject T::operator * () {                                                                     \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_indirection, {});            \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::indirection, {});             \
     }                                                                                                   \
     SharedObject T::assign(const ObjectPtr& other) const {                                              \
-        return ReflMgr::Instance().Invoke(*(T*)this,                                                    \
-            MetaMethods::operator_assign, std::vector<ObjectPtr>{ other });                             \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::assign, { &other, 1 });       \
     }                                                                                                   \
 
-#define BIDEF(T, op, meta)                                                                                      \
-    SharedObject T::operator op (const T& other) const {                                                        \
-        return ReflMgr::Instance().Invoke(*(T*)this, MetaMethods::operator_ ## meta, std::vector<T>{ other });  \
+#define BIDEF(T, op, meta)                                                                              \
+    SharedObject T::operator op (const T& other) const {                                                \
+        ObjectPtr arg = other;                                                                          \
+        return ReflMgr::Instance().InvokeOperator(*this, MetaMethods::Op::meta, { &arg, 1 });           \
     }
 
 DEFOPS(SharedObject)
@@ -182,7 +236,7 @@ DEFOPS(ObjectPtr)
 #undef BIDEF
 
 std::ostream& operator << (std::ostream& out, const ObjectPtr& ptr) {
-    auto obj = ptr.Invoke(MetaMethods::operator_tostring, {});
+    auto obj = ptr.tostring();
     if (obj.GetType() != TypeID::get<std::string>()) {
         return out;
     }
@@ -191,7 +245,7 @@ std::ostream& operator << (std::ostream& out, const ObjectPtr& ptr) {
 }
 
 std::ostream& operator << (std::ostream& out, const SharedObject& ptr) {
-    auto obj = ptr.Invoke(MetaMethods::operator_tostring, {});
+    auto obj = ptr.tostring();
     if (obj.GetType() != TypeID::get<std::string>()) {
         return out;
     }
@@ -199,13 +253,17 @@ std::ostream& operator << (std::ostream& out, const SharedObject& ptr) {
     return out;
 }
 
-SharedObject::~SharedObject() {
-    if (id == TypeID::get<void>() || ptr.use_count() != 1) {
+void SharedObject::Release() {
+    if (id == TypeID::get<void>() || inlined || ptr.use_count() != 1) {
         return;
     }
     dtor();
 }
 
+SharedObject::~SharedObject() {
+    Release();
+}
+
 ObjectPtr::operator bool() const {
     return this->Get<bool>();
 }
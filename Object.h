@@ -1,11 +1,15 @@
 #pragma once
 #include <memory>
+#include <new>
 #include <variant>
 #include "TypeID.h"
+#include "Allocator.h"
+#include "Symbol.h"
 #include "MetaMethods.h"
 
 class ObjectPtr;
 class SharedObject;
+class InvokeCache;
 
 #define DEFOPS(T)       \
     BIDEF(T, +)         \
@@ -57,8 +61,11 @@ class ObjectPtr {
         void* GetRawPtr() const;
         SharedObject ToSharedPtr() const;
         ObjectPtr GetField(std::string_view member) const;
+        ObjectPtr GetField(Symbol member) const;
         SharedObject Invoke(std::string_view method, const std::vector<ObjectPtr>& params = {}) const;
         SharedObject TryInvoke(std::string_view method, const std::vector<ObjectPtr>& params = {}) const;
+        SharedObject Invoke(InvokeCache& cache, const std::vector<ObjectPtr>& params = {}) const;
+        SharedObject Invoke(Symbol method, const std::vector<ObjectPtr>& params = {}) const;
         template<typename T> T& As() { return *(T*)ptr; }
         template<typename T> const T& Get() const { return *(T*)ptr; }
         friend class SharedObject;
@@ -76,31 +83,96 @@ class SharedObject {
     private:
         TypeID id;
         std::shared_ptr<void> ptr;
-        void* objPtr;
+        void* objPtr = nullptr;
+        // an inline value is copied with the object, so copies do not alias it
+        alignas(TypeID) unsigned char local[sizeof(TypeID)];
+        bool inlined = false;
+        // runs __dtor if this holds the last reference to a heap value
+        void Release();
+        struct Slot {
+            alignas(TypeID) unsigned char data[sizeof(TypeID)];
+        };
+        template<typename T, typename... Args>
+        static SharedObject NewInline(Args&&... args) {
+            static_assert(StoresInline<T>);
+            SharedObject obj;
+            obj.id = TypeID::get<T>();
+            obj.inlined = true;
+            new (obj.local) T(std::forward<Args&&>(args)...);
+            return obj;
+        }
     public:
+        // small scalars live in the object itself: no allocation, no refcount and
+        // no reflective __ctor/__dtor
+        template<typename T>
+        static constexpr bool StoresInline = (std::is_arithmetic_v<T> || std::is_same_v<T, TypeID> || std::is_same_v<T, std::string_view>)
+            && std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(Slot) && alignof(T) <= alignof(Slot);
         template<typename T, typename... Args>
         static SharedObject New(Args&&... args) {
-            return SharedObject{TypeID::get<T>(), std::make_shared<T>(std::forward<Args&&>(args)...)};
+            if constexpr (StoresInline<T>) {
+                return NewInline<T>(std::forward<Args&&>(args)...);
+            } else {
+                return SharedObject{TypeID::get<T>(), std::allocate_shared<T>(ObjectAllocator<T>(), std::forward<Args&&>(args)...)};
+            }
         }
         template<typename T>
         static SharedObject New(const T& val) {
-            return SharedObject{TypeID::get<T>(), std::make_shared<T>(val)};
+            if constexpr (StoresInline<T>) {
+                return NewInline<T>(val);
+            } else {
+                return SharedObject{TypeID::get<T>(), std::allocate_shared<T>(ObjectAllocator<T>(), val)};
+            }
+        }
+        // always on the heap, so copies share one value even for small scalars
+        template<typename T, typename... Args>
+        static SharedObject NewShared(Args&&... args) {
+            return SharedObject{TypeID::get<T>(), std::allocate_shared<T>(ObjectAllocator<T>(), std::forward<Args&&>(args)...)};
         }
         DEFOPS(SharedObject)
         static const SharedObject Null;
         SharedObject();
         SharedObject(const SharedObject& other);
+        SharedObject(SharedObject&& other) noexcept;
+        SharedObject& operator = (const SharedObject& other);
+        SharedObject& operator = (SharedObject&& other) noexcept;
         SharedObject(TypeID id, void* objPtr);
         SharedObject(TypeID id, std::shared_ptr<void> ptr, bool call_ctor = true);
         bool isObjectPtr() const;
+        bool isInline() const;
         TypeID GetType() const;
         std::shared_ptr<void> GetPtr() const;
         void* GetRawPtr() const;
         ObjectPtr GetField(std::string_view member) const;
+        ObjectPtr GetField(Symbol member) const;
         SharedObject Invoke(std::string_view method, const std::vector<ObjectPtr>& params = {}) const;
         SharedObject TryInvoke(std::string_view method, const std::vector<ObjectPtr>& params = {}) const;
+        SharedObject Invoke(InvokeCache& cache, const std::vector<ObjectPtr>& params = {}) const;
+        SharedObject Invoke(Symbol method, const std::vector<ObjectPtr>& params = {}) const;
         template<typename T> T& As() { return *(T*)GetRawPtr(); }
         template<typename T> const T& Get() const { return *(T*)GetRawPtr(); }
+        // Replaces the held value with a T constructed from args, without a
+        // default construction in between. Like New, a heap value then gets
+        // the reflective __ctor and later the matching __dtor; inline values
+        // get neither.
+        template<typename T, typename... Args>
+        T& Emplace(Args&&... args) {
+            Release();
+            if constexpr (StoresInline<T>) {
+                static_assert(sizeof(T) <= sizeof(local) && alignof(T) <= alignof(TypeID));
+                ptr.reset();
+                objPtr = nullptr;
+                new (local) T(std::forward<Args&&>(args)...);
+                inlined = true;
+                id = TypeID::get<T>();
+            } else {
+                ptr = std::allocate_shared<T>(ObjectAllocator<T>(), std::forward<Args&&>(args)...);
+                objPtr = nullptr;
+                inlined = false;
+                id = TypeID::get<T>();
+                ctor({});
+            }
+            return As<T>();
+        }
         ObjectPtr ToObjectPtr() const;
         ~SharedObject();
         friend class ObjectPtr;
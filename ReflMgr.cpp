@@ -1,22 +1,31 @@
+#include <algorithm>
 #include "ReflMgr.h"
 
 ReflMgr::Any::Any(ObjectPtr obj) : ObjectPtr(obj) {}
 
-FieldInfo& FieldInfo::withRegister(std::function<ObjectPtr(void*)> getRegister) {
-    this->getRegister = getRegister;
+FieldInfo& FieldInfo::withRegister(Trampoline<ObjectPtr(void*)> getRegister) {
+    this->getRegister = std::move(getRegister);
     return *this;
 }
 
-MethodInfo& MethodInfo::withRegister(std::function<FuncType> getRegister) {
-    this->getRegister = getRegister;
+MethodInfo& MethodInfo::withRegister(Trampoline<FuncType> getRegister) {
+    this->getRegister = std::move(getRegister);
     return *this;
 }
 
+ReflMgr::ReflMgr() {}
+
+ReflMgr::~ReflMgr() {}
+
 ReflMgr& ReflMgr::Instance() {
     static ReflMgr instance;
     return instance;
 }
 
+size_t ReflMgr::GetVersion() const {
+    return IsFrozen() ? publishedVersion.load() : version.load();
+}
+
 #define ERROR std::cerr << errorMsgPrefix
 void ReflMgr::SetErrorMsgPrefix(const std::string& msg) {
     errorMsgPrefix = msg;
@@ -24,43 +33,45 @@ void ReflMgr::SetErrorMsgPrefix(const std::string& msg) {
 
 TypeID ReflMgr::GetType(std::string_view clsName) {
     auto& instance = ReflMgr::Instance();
+    ReadGuard guard;
     TypeID target = TypeID::getRaw(clsName);
-    if (!instance.HasClassInfo(target)) {
-        return target;
-    }
-    while (!instance.classInfo[target].aliasTo.isNull()) {
-        target = instance.classInfo[target].aliasTo;
+    const ClassInfo* info = instance.FindClass(target);
+    while (info != nullptr && !info->aliasTo.isNull()) {
+        target = info->aliasTo;
+        info = instance.FindClass(target);
     }
     return target;
 }
 
 template<typename T> T* ReflMgr::SafeGetList(TypeIDMap<T>& info, TypeID id) {
-    if (info.find(id) == info.end()) {
+    auto iter = info.find(id);
+    if (iter == info.end()) {
         return nullptr;
     }
-    return &info[id];
+    return &iter->second;
 }
 
 template ClassInfo* ReflMgr::SafeGetList(TypeIDMap<ClassInfo>& info, TypeID id);
-template std::unordered_map<std::string, std::vector<MethodInfo>>* ReflMgr::SafeGetList(TypeIDMap<std::unordered_map<std::string, std::vector<MethodInfo>>>& info, TypeID id);
-template std::unordered_map<std::string, FieldInfo>* ReflMgr::SafeGetList(TypeIDMap<std::unordered_map<std::string, FieldInfo>>& info, TypeID id);
+template SymbolMap<OverloadList>* ReflMgr::SafeGetList(TypeIDMap<SymbolMap<OverloadList>>& info, TypeID id);
+template SymbolMap<FieldInfo>* ReflMgr::SafeGetList(TypeIDMap<SymbolMap<FieldInfo>>& info, TypeID id);
 
-template<typename T> T* ReflMgr::SafeGet(TypeIDMap<std::unordered_map<std::string, T>>& info, TypeID id, std::string_view name) {
+template<typename T> T* ReflMgr::SafeGet(TypeIDMap<SymbolMap<T>>& info, TypeID id, Symbol name) {
     auto* lst = SafeGetList(info, id);
     if (lst == nullptr) {
         return nullptr;
     }
-    if (lst->find(std::string{name}) == lst->end()) {
+    auto iter = lst->find(name);
+    if (iter == lst->end()) {
         return nullptr;
     }
-    return &(*lst)[std::string{name}];
+    return &iter->second;
 }
 
-template std::vector<MethodInfo>* ReflMgr::SafeGet(TypeIDMap<std::unordered_map<std::string, std::vector<MethodInfo>>>& info, TypeID id, std::string_view name);
-template FieldInfo* ReflMgr::SafeGet(TypeIDMap<std::unordered_map<std::string, FieldInfo>>& info, TypeID id, std::string_view name);
+template OverloadList* ReflMgr::SafeGet(TypeIDMap<SymbolMap<OverloadList>>& info, TypeID id, Symbol name);
+template FieldInfo* ReflMgr::SafeGet(TypeIDMap<SymbolMap<FieldInfo>>& info, TypeID id, Symbol name);
 
 template<typename MethodInfoType>
-void ReflMgr::CheckParams(MethodInfoType& info, const ArgsTypeList& lst, MethodInfoType** rec, bool showError) {
+void ReflMgr::CheckParams(MethodInfoType& info, std::span<const TypeID> lst, MethodInfoType** rec, bool showError) {
     if (info.argsList.size() != lst.size()) {
         return;
     }
@@ -99,16 +110,12 @@ void ReflMgr::CheckParams(MethodInfoType& info, const ArgsTypeList& lst, MethodI
     }
 }
 
-template void ReflMgr::CheckParams(MethodInfo& info, const ArgsTypeList& lst, MethodInfo** rec, bool showError);
-template void ReflMgr::CheckParams(MethodInfo const& info, const ArgsTypeList& lst, MethodInfo const** rec, bool showError);
+template void ReflMgr::CheckParams(MethodInfo& info, std::span<const TypeID> lst, MethodInfo** rec, bool showError);
+template void ReflMgr::CheckParams(MethodInfo const& info, std::span<const TypeID> lst, MethodInfo const** rec, bool showError);
 
-const MethodInfo* ReflMgr::SafeGet(TypeID id, std::string_view name, const ArgsTypeList& args) {
-    auto* lst = SafeGet(methodInfo, id, name);
-    if (lst == nullptr) {
-        return nullptr;
-    }
+const MethodInfo* ReflMgr::ResolveOverload(const OverloadList& overloads, std::span<const TypeID> args, bool showError) {
     const MethodInfo* rec[3] = { nullptr, nullptr, nullptr };
-    for (const auto& info : *lst) {
+    for (const auto& info : overloads) {
         CheckParams(info, args, rec);
     }
     for (int i = 0; i < 3; i++) {
@@ -116,32 +123,322 @@ const MethodInfo* ReflMgr::SafeGet(TypeID id, std::string_view name, const ArgsT
             return rec[i];
         }
     }
-    for (const auto& info : *lst) {
-        CheckParams(info, args, rec, true);
+    if (showError) {
+        for (const auto& info : overloads) {
+            CheckParams(info, args, rec, true);
+        }
     }
     return nullptr;
 }
 
-template<typename Ret> Ret* ReflMgr::WalkThroughInherits(std::function<void*(void*)>* conv, TypeID id, std::function<Ret*(TypeID)> func) {
-    std::queue<std::pair<TypeID, std::function<void*(void*)>>> q;
-    q.push({id, *conv});
+ThisAdjust ThisAdjust::Then(const BaseCast& next) const {
+    if (next.thunk == nullptr) {
+        return { offset + next.offset, thunk };
+    }
+    if (!thunk && offset == 0) {
+        return { next.offset, next.thunk };
+    }
+    return { next.offset, [prev = *this, next](void* instance) { return next.thunk(prev(instance)); } };
+}
+
+void ReflMgr::BuildMemberTable(TypeID id, MemberTable& table, TypeIDMap<SymbolMap<FieldInfo>>& fieldInfo, TypeIDMap<SymbolMap<OverloadList>>& methodInfo, TypeIDMap<ClassInfo>& classInfo) {
+    table.fields.clear();
+    table.methods.clear();
+    std::vector<size_t> visited;
+    std::queue<std::pair<TypeID, ThisAdjust>> q;
+    q.push({id, ThisAdjust{}});
     while (!q.empty()) {
         auto type = q.front().first;
-        auto convFunc = q.front().second;
+        auto adjust = q.front().second;
         q.pop();
-        auto* ret = func(type);
-        if (ret != nullptr) {
-            *conv = convFunc;
-            return ret;
+        if (std::find(visited.begin(), visited.end(), type.getHash()) != visited.end()) {
+            continue;
+        }
+        visited.push_back(type.getHash());
+        if (auto* fields = SafeGetList(fieldInfo, type)) {
+            for (auto& field : *fields) {
+                table.fields.try_emplace(field.first, FieldEntry{ &field.second, adjust });
+            }
         }
-        if (HasClassInfo(type)) {
-            ClassInfo& info = classInfo[type];
-            for (int i = 0; i < info.parents.size(); i++) {
-                q.push({info.parents[i], [convFunc, info, i](void* instance) { return info.cast[i](convFunc(instance)); }});
+        if (auto* methods = SafeGetList(methodInfo, type)) {
+            for (auto& method : *methods) {
+                table.methods[method.first].push_back({ &method.second, adjust });
+            }
+        }
+        if (auto* info = SafeGetList(classInfo, type)) {
+            for (int i = 0; i < info->parents.size(); i++) {
+                q.push({info->parents[i], adjust.Then(info->cast[i])});
             }
         }
     }
-    return nullptr;
+    for (size_t i = 0; i < table.ops.size(); i++) {
+        auto iter = table.methods.find(MetaMethods::opNames[i]);
+        table.ops[i] = iter == table.methods.end() ? std::span<const MethodEntry>() : iter->second;
+    }
+    table.version = version;
+}
+
+const ReflMgr::MemberTable& ReflMgr::GetMemberTable(TypeID id) {
+    static thread_local TypeIDMap<MemberTable> memberTables;
+    MemberTable& table = memberTables[id];
+    if (table.version != version) {
+        BuildMemberTable(id, table, fieldInfo, methodInfo, classInfo);
+    }
+    return table;
+}
+
+struct ReflMgr::Frozen : std::enable_shared_from_this<ReflMgr::Frozen> {
+    struct Class {
+        size_t hash;
+        const ClassInfo* info;
+        unsigned fieldBegin, fieldEnd;
+        unsigned methodBegin, methodEnd;
+    };
+    struct Field {
+        unsigned symbol;
+        FieldEntry entry;
+    };
+    struct Method {
+        unsigned symbol;
+        unsigned begin, end;
+    };
+    // own copies of the registry, writers keep mutating the master maps
+    TypeIDMap<SymbolMap<FieldInfo>> fieldInfo;
+    TypeIDMap<SymbolMap<OverloadList>> methodInfo;
+    TypeIDMap<ClassInfo> classInfo;
+    std::vector<Class> classes;
+    std::vector<Field> fields;
+    std::vector<Method> methods;
+    std::vector<MethodEntry> methodEntries;
+    std::vector<OpSlots> ops;
+    const Class* FindClass(size_t hash) const {
+        auto iter = std::lower_bound(classes.begin(), classes.end(), hash, [](const Class& cls, size_t hash) { return cls.hash < hash; });
+        if (iter == classes.end() || iter->hash != hash) {
+            return nullptr;
+        }
+        return &*iter;
+    }
+    template<typename T>
+    static const T* FindSymbol(const std::vector<T>& lst, unsigned begin, unsigned end, unsigned symbol) {
+        auto iter = std::lower_bound(lst.begin() + begin, lst.begin() + end, symbol, [](const T& item, unsigned symbol) { return item.symbol < symbol; });
+        if (iter == lst.begin() + end || iter->symbol != symbol) {
+            return nullptr;
+        }
+        return &*iter;
+    }
+};
+
+// Epoch based reclamation for published snapshots. A reader announces the
+// global epoch in its slot before loading the snapshot pointer; a snapshot
+// retired at epoch e is released once every active slot has moved past e.
+struct EpochSlot {
+    std::atomic<size_t> epoch = 0;
+    std::atomic<bool> used = false;
+    EpochSlot* next = nullptr;
+};
+
+static std::atomic<size_t> globalEpoch = 1;
+static std::atomic<EpochSlot*> epochSlots = nullptr;
+
+struct ThreadEpoch {
+    EpochSlot* slot = nullptr;
+    int depth = 0;
+    const void* snapshot = nullptr;
+    ThreadEpoch() {
+        for (auto* p = epochSlots.load(); p != nullptr; p = p->next) {
+            bool expected = false;
+            if (p->used.compare_exchange_strong(expected, true)) {
+                slot = p;
+                return;
+            }
+        }
+        slot = new EpochSlot;
+        slot->used = true;
+        slot->next = epochSlots.load();
+        while (!epochSlots.compare_exchange_weak(slot->next, slot));
+    }
+    ~ThreadEpoch() {
+        slot->epoch = 0;
+        slot->used = false;
+    }
+};
+
+static thread_local ThreadEpoch threadEpoch;
+
+ReflMgr::ReadGuard::ReadGuard() {
+    if (threadEpoch.depth++ == 0) {
+        threadEpoch.slot->epoch = globalEpoch.load();
+        threadEpoch.snapshot = ReflMgr::Instance().frozen.load();
+    }
+}
+
+ReflMgr::ReadGuard::~ReadGuard() {
+    if (--threadEpoch.depth == 0) {
+        threadEpoch.snapshot = nullptr;
+        threadEpoch.slot->epoch = 0;
+    }
+}
+
+ReflMgr::WriteBatch::WriteBatch() {
+    auto& mgr = ReflMgr::Instance();
+    mgr.writeMutex.lock();
+    mgr.writeDepth++;
+}
+
+ReflMgr::WriteBatch::~WriteBatch() {
+    auto& mgr = ReflMgr::Instance();
+    if (--mgr.writeDepth == 0 && mgr.IsFrozen() && mgr.version != mgr.publishedVersion) {
+        mgr.Publish();
+    }
+    mgr.writeMutex.unlock();
+}
+
+const ReflMgr::Frozen* ReflMgr::Current() const {
+    if (threadEpoch.depth > 0) {
+        return (const Frozen*)threadEpoch.snapshot;
+    }
+    return frozen.load();
+}
+
+std::shared_ptr<const void> ReflMgr::Pin() const {
+    auto* snapshot = Current();
+    if (snapshot == nullptr) {
+        return nullptr;
+    }
+    return snapshot->shared_from_this();
+}
+
+void ReflMgr::Publish() {
+    auto result = std::make_shared<Frozen>();
+    result->fieldInfo = fieldInfo;
+    result->methodInfo = methodInfo;
+    result->classInfo = classInfo;
+    std::vector<TypeID> types;
+    for (auto& cls : classInfo) {
+        types.push_back(cls.first);
+    }
+    for (auto& cls : fieldInfo) {
+        types.push_back(cls.first);
+    }
+    for (auto& cls : methodInfo) {
+        types.push_back(cls.first);
+    }
+    std::sort(types.begin(), types.end());
+    types.erase(std::unique(types.begin(), types.end(), TypeIDHashEqual()), types.end());
+    result->classes.reserve(types.size());
+    for (auto type : types) {
+        MemberTable table;
+        BuildMemberTable(type, table, result->fieldInfo, result->methodInfo, result->classInfo);
+        Frozen::Class cls = { type.getHash(), SafeGetList(result->classInfo, type) };
+        cls.fieldBegin = result->fields.size();
+        for (auto& field : table.fields) {
+            result->fields.push_back({ field.first.getID(), field.second });
+        }
+        cls.fieldEnd = result->fields.size();
+        std::sort(result->fields.begin() + cls.fieldBegin, result->fields.end(), [](const Frozen::Field& a, const Frozen::Field& b) { return a.symbol < b.symbol; });
+        cls.methodBegin = result->methods.size();
+        for (auto& method : table.methods) {
+            unsigned begin = result->methodEntries.size();
+            result->methodEntries.insert(result->methodEntries.end(), method.second.begin(), method.second.end());
+            result->methods.push_back({ method.first.getID(), begin, (unsigned)result->methodEntries.size() });
+        }
+        cls.methodEnd = result->methods.size();
+        std::sort(result->methods.begin() + cls.methodBegin, result->methods.end(), [](const Frozen::Method& a, const Frozen::Method& b) { return a.symbol < b.symbol; });
+        result->classes.push_back(cls);
+    }
+    result->ops.resize(result->classes.size());
+    for (int i = 0; i < result->classes.size(); i++) {
+        auto& cls = result->classes[i];
+        for (size_t op = 0; op < (size_t)MetaMethods::Op::Count; op++) {
+            auto name = Symbol::find(MetaMethods::opNames[op]);
+            if (auto* method = Frozen::FindSymbol(result->methods, cls.methodBegin, cls.methodEnd, name.getID())) {
+                result->ops[i][op] = { result->methodEntries.data() + method->begin, method->end - method->begin };
+            }
+        }
+    }
+    frozen = result.get();
+    publishedVersion = version.load();
+    if (current != nullptr) {
+        retired.push_back({ globalEpoch.fetch_add(1), std::move(current) });
+    }
+    current = std::move(result);
+    Reclaim();
+}
+
+void ReflMgr::Reclaim() {
+    size_t oldest = -1;
+    for (auto* p = epochSlots.load(); p != nullptr; p = p->next) {
+        size_t epoch = p->epoch.load();
+        if (epoch != 0) {
+            oldest = std::min(oldest, epoch);
+        }
+    }
+    std::erase_if(retired, [oldest](const auto& item) { return item.first < oldest; });
+}
+
+void ReflMgr::Freeze() {
+    WriteBatch batch;
+    if (IsFrozen()) {
+        return;
+    }
+    Publish();
+}
+
+bool ReflMgr::IsFrozen() const {
+    return frozen.load() != nullptr;
+}
+
+const ClassInfo* ReflMgr::FindClass(TypeID id) {
+    if (auto* frozen = Current()) {
+        auto* cls = frozen->FindClass(id.getHash());
+        return cls == nullptr ? nullptr : cls->info;
+    }
+    return SafeGetList(classInfo, id);
+}
+
+const ReflMgr::FieldEntry* ReflMgr::FindField(TypeID id, Symbol name) {
+    if (auto* frozen = Current()) {
+        auto* cls = frozen->FindClass(id.getHash());
+        if (cls == nullptr) {
+            return nullptr;
+        }
+        auto* field = Frozen::FindSymbol(frozen->fields, cls->fieldBegin, cls->fieldEnd, name.getID());
+        return field == nullptr ? nullptr : &field->entry;
+    }
+    auto& fields = GetMemberTable(id).fields;
+    auto iter = fields.find(name);
+    return iter == fields.end() ? nullptr : &iter->second;
+}
+
+std::span<const ReflMgr::MethodEntry> ReflMgr::FindMethods(TypeID id, Symbol name) {
+    if (auto* frozen = Current()) {
+        auto* cls = frozen->FindClass(id.getHash());
+        if (cls == nullptr) {
+            return {};
+        }
+        auto* method = Frozen::FindSymbol(frozen->methods, cls->methodBegin, cls->methodEnd, name.getID());
+        if (method == nullptr) {
+            return {};
+        }
+        return { frozen->methodEntries.data() + method->begin, method->end - method->begin };
+    }
+    auto& methods = GetMemberTable(id).methods;
+    auto iter = methods.find(name);
+    if (iter == methods.end()) {
+        return {};
+    }
+    return iter->second;
+}
+
+std::span<const ReflMgr::MethodEntry> ReflMgr::FindOperator(TypeID id, MetaMethods::Op op) {
+    if (auto* frozen = Current()) {
+        auto* cls = frozen->FindClass(id.getHash());
+        if (cls == nullptr) {
+            return {};
+        }
+        return frozen->ops[cls - frozen->classes.data()][(size_t)op];
+    }
+    return GetMemberTable(id).ops[(size_t)op];
 }
 
 bool MethodInfo::sameDeclareTo(const MethodInfo& other) const {
@@ -157,7 +454,12 @@ bool MethodInfo::sameDeclareTo(const MethodInfo& other) const {
 }
 
 void ReflMgr::AddMethodInfo(TypeID type, const std::string& name, MethodInfo info, bool overridePrevious) {
-    std::vector<MethodInfo>& lst = methodInfo[type][name];
+    WriteBatch batch;
+    OverloadList& lst = methodInfo[type][Symbol::intern(name)];
+    version++;
+    if (name == MetaMethods::operator_ctor || name == MetaMethods::operator_dtor) {
+        MarkHook(type, name == MetaMethods::operator_dtor);
+    }
     for (MethodInfo& data : lst) {
         if (data.sameDeclareTo(info)) {
             if (overridePrevious) {
@@ -174,24 +476,39 @@ void ReflMgr::AddMethodInfo(TypeID type, const std::string& name, MethodInfo inf
             }
         }
     }
-    methodInfo[type][name].push_back(info);
+    lst.push_back(info);
+    if (name == MetaMethods::operator_ctor || name == MetaMethods::operator_dtor) {
+        RecordHooks(type);
+    }
 }
 
-template FieldInfo* ReflMgr::WalkThroughInherits(std::function<void*(void*)>* conv, TypeID id, std::function<FieldInfo*(TypeID)> func);
-template MethodInfo* ReflMgr::WalkThroughInherits(std::function<void*(void*)>* conv, TypeID id, std::function<MethodInfo*(TypeID)> func);
-
-const FieldInfo* ReflMgr::SafeGetFieldWithInherit(std::function<void*(void*)>* conv, TypeID id, std::string_view name, bool showError) {
-    auto ret = WalkThroughInherits(conv, id, std::function([&](TypeID type) { return SafeGet(fieldInfo, type, name); }));
+const FieldInfo* ReflMgr::SafeGetFieldWithInherit(ThisAdjust* adjust, TypeID id, MemberName name, bool showError) {
+    const FieldInfo* ret = nullptr;
+    if (!name.symbol.isNull()) {
+        if (auto* entry = FindField(id, name.symbol)) {
+            *adjust = entry->adjust;
+            ret = entry->info;
+        }
+    }
     if (ret == nullptr && showError) {
-        ERROR << "Error: no matching field found: " << id.getName() << "::" << name << std::endl;
+        ERROR << "Error: no matching field found: " << id.getName() << "::" << name.name << std::endl;
     }
     return ret;
 }
 
-const MethodInfo* ReflMgr::SafeGetMethodWithInherit(std::function<void*(void*)>* conv, TypeID id, std::string_view name, const ArgsTypeList& args, bool showError) {
-    auto ret = WalkThroughInherits(conv, id, std::function([&](TypeID type) { return SafeGet(type, name, args); }));
+const MethodInfo* ReflMgr::SafeGetMethodWithInherit(ThisAdjust* adjust, TypeID id, MemberName name, std::span<const TypeID> args, bool showError) {
+    const MethodInfo* ret = nullptr;
+    if (!name.symbol.isNull()) {
+        for (auto& entry : FindMethods(id, name.symbol)) {
+            ret = ResolveOverload(*entry.overloads, args, showError);
+            if (ret != nullptr) {
+                *adjust = entry.adjust;
+                break;
+            }
+        }
+    }
     if (ret == nullptr && showError) {
-        ERROR << "Error: no matching method found: " << id.getName() << "::" << name << "(";
+        ERROR << "Error: no matching method found: " << id.getName() << "::" << name.name << "(";
         if (args.size() > 0) {
             ERROR << args[0].getName();
             for (int i = 1; i < args.size(); i++) {
@@ -203,8 +520,85 @@ const MethodInfo* ReflMgr::SafeGetMethodWithInherit(std::function<void*(void*)>*
     return ret;
 }
 
+// Per-thread memo of overload resolution, direct mapped on a hash of the
+// receiver, name and argument types. It belongs to one registry version and
+// snapshot; any registration (AddMethodInfo included) bumps the version and
+// invalidates every entry at once.
+struct ReflMgr::ResolveMemo {
+    static constexpr size_t Size = 256;
+    struct Entry {
+        size_t generation = 0;
+        size_t signature = 0;
+        TypeID type;
+        Symbol symbol;
+        std::vector<TypeID> args;
+        Resolution result;
+    };
+    size_t generation = 1;
+    size_t version = -1;
+    const void* snapshot = nullptr;
+    Entry entries[Size];
+};
+
+const ReflMgr::Resolution* ReflMgr::ResolveMethod(TypeID id, MemberName name, std::span<const TypeID> args, bool showError) {
+    static thread_local ResolveMemo memo;
+    const void* snapshot = Current();
+    if (memo.version != version.load() || memo.snapshot != snapshot) {
+        memo.version = version.load();
+        memo.snapshot = snapshot;
+        memo.generation++;
+    }
+    size_t signature = id.getHash() ^ ((size_t)name.symbol.getID() * 0x9e3779b97f4a7c15);
+    for (const auto& arg : args) {
+        signature ^= arg.getHash() + 0x9e3779b97f4a7c15 + (signature << 6) + (signature >> 2);
+    }
+    auto& entry = memo.entries[signature % ResolveMemo::Size];
+    if (entry.generation == memo.generation && entry.signature == signature && entry.type == id && entry.symbol == name.symbol && std::equal(args.begin(), args.end(), entry.args.begin(), entry.args.end())) {
+        if (entry.result.info == nullptr) {
+            if (showError) {
+                ThisAdjust adjust;
+                SafeGetMethodWithInherit(&adjust, id, name, args, true);
+            }
+            return nullptr;
+        }
+        return &entry.result;
+    }
+    ThisAdjust adjust;
+    auto* info = SafeGetMethodWithInherit(&adjust, id, name, args, showError);
+    entry.generation = memo.generation;
+    entry.signature = signature;
+    entry.type = id;
+    entry.symbol = name.symbol;
+    entry.args.assign(args.begin(), args.end());
+    entry.result.info = info;
+    entry.result.adjust = std::move(adjust);
+    if (info == nullptr) {
+        return nullptr;
+    }
+    BuildPlan(*info, args, entry.result.plan);
+    return &entry.result;
+}
+
+const TypedCall* ReflMgr::FindTypedCall(ThisAdjust* adjust, TypeID type, MemberName name, TypeID signature, bool showError) {
+    if (!name.symbol.isNull()) {
+        for (auto& entry : FindMethods(type, name.symbol)) {
+            for (auto& info : *entry.overloads) {
+                if (info.typed.thunk != nullptr && info.typed.signature == signature.getHash()) {
+                    *adjust = entry.adjust;
+                    return &info.typed;
+                }
+            }
+        }
+    }
+    if (showError) {
+        ERROR << "Error: no method matching signature found: " << type.getName() << "::" << name.name << " " << signature.getName() << std::endl;
+    }
+    return nullptr;
+}
+
 bool ReflMgr::HasClassInfo(TypeID type) {
-    return classInfo.find(type) != classInfo.end();
+    ReadGuard guard;
+    return FindClass(type) != nullptr;
 }
 
 static inline std::string_view removeNameRefAndConst(std::string_view name) {
@@ -219,102 +613,626 @@ static inline std::string_view removeNameRefAndConst(std::string_view name) {
 }
 
 SharedObject ReflMgr::New(TypeID type, const std::vector<ObjectPtr>& args) {
-    auto& func = classInfo[TypeID::getRaw(removeNameRefAndConst(type.getName()))].newObject;
-    if (func == 0) {
+    ReadGuard guard;
+    auto* info = FindClass(TypeID::getRaw(removeNameRefAndConst(type.getName())));
+    if (info == nullptr || !info->newObject) {
         ERROR << "Error: unable to init an unregistered class: " << type.getName() << std::endl;
         return SharedObject::Null;
     }
-    return func(args);
+    return info->newObject(args);
 }
 
 SharedObject ReflMgr::New(std::string_view typeName, const std::vector<ObjectPtr>& args) {
     return New(ReflMgr::GetType(typeName), args);
 }
 
-ObjectPtr ReflMgr::RawGetField(TypeID type, void* instance, std::string_view member) {
-    std::function<void*(void*)> conv = [](void* orig) { return orig; };
-    auto* p = SafeGetFieldWithInherit(&conv, type, member);
+ObjectPtr ReflMgr::RawGetField(TypeID type, void* instance, MemberName member) {
+    ThisAdjust adjust;
+    ReadGuard guard;
+    auto* p = SafeGetFieldWithInherit(&adjust, type, member);
     if (p == nullptr) {
         return ObjectPtr::Null;
     }
-    return p->getRegister(conv(instance));
+    if (p->offset >= 0 && !adjust.thunk && instance != nullptr) {
+        return ObjectPtr{ p->varType, (char*)instance + adjust.offset + p->offset };
+    }
+    return p->getRegister(adjust(instance));
+}
+
+FieldHandle ReflMgr::GetFieldHandle(TypeID type, MemberName member, bool showError) {
+    FieldHandle handle;
+    ReadGuard guard;
+    auto* info = SafeGetFieldWithInherit(&handle.adjust, type, member, showError);
+    if (info == nullptr) {
+        return FieldHandle();
+    }
+    handle.info = info;
+    handle.type = type;
+    if (info->offset >= 0 && !handle.adjust.thunk) {
+        handle.offset = handle.adjust.offset + info->offset;
+    }
+    handle.pin = Pin();
+    return handle;
+}
+
+bool FieldHandle::IsValid() const {
+    return info != nullptr;
+}
+
+FieldHandle::operator bool() const {
+    return IsValid();
+}
+
+bool FieldHandle::HasOffset() const {
+    return offset >= 0;
+}
+
+ptrdiff_t FieldHandle::GetOffset() const {
+    return offset;
+}
+
+const FieldInfo* FieldHandle::GetFieldInfo() const {
+    return info;
+}
+
+TypeID FieldHandle::GetOwnerType() const {
+    return type;
+}
+
+ObjectPtr FieldHandle::Get(void* instance) const {
+    if (offset >= 0) {
+        return ObjectPtr{ info->varType, (char*)instance + offset };
+    }
+    return info->getRegister(adjust(instance));
+}
+
+ObjectPtr FieldHandle::Get(ObjectPtr instance) const {
+    return Get(instance.GetRawPtr());
 }
 
 std::function<void(void*, std::vector<void*>, SharedObject& ret)> ReflMgr::GetInvokeFunc(TypeID type, std::string_view member, ArgsTypeList list) {
-    std::function<void*(void*)> conv = [](void* orig) { return orig; };
-    auto* info = SafeGetMethodWithInherit(&conv, type, member, list);
+    ThisAdjust adjust;
+    ReadGuard guard;
+    auto* info = SafeGetMethodWithInherit(&adjust, type, member, list);
     if (info == nullptr || info->name == "") {
         return nullptr;
     }
-    return [info, conv](void* instance, std::vector<void*> params, SharedObject& ret) {
-        info->getRegister(conv(instance), params, ret);
+    return [info, adjust, pin = Pin()](void* instance, std::vector<void*> params, SharedObject& ret) {
+        info->getRegister(adjust(instance), params, ret);
     };
 }
 
+void ReflMgr::BuildPlan(const MethodInfo& info, std::span<const TypeID> args, std::vector<MethodHandle::ArgMode>& plan) {
+    plan.clear();
+    for (int i = 0; i < info.argsList.size(); i++) {
+        if (info.argsList[i].getHash() == TypeID::get<ReflMgr::Any>().getHash()) {
+            plan.push_back(MethodHandle::ArgMode::Generic);
+        } else if (info.argsList[i].getHash() != args[i].getHash()) {
+            plan.push_back(MethodHandle::ArgMode::Convert);
+        } else {
+            plan.push_back(MethodHandle::ArgMode::Direct);
+        }
+    }
+}
+
+MethodHandle ReflMgr::GetMethodHandle(TypeID type, MemberName member, const ArgsTypeList& list, bool showError) {
+    MethodHandle handle;
+    ReadGuard guard;
+    auto* resolved = ResolveMethod(type, member, list, showError);
+    if (resolved == nullptr || resolved->info->name == "") {
+        return MethodHandle();
+    }
+    handle.info = resolved->info;
+    handle.adjust = resolved->adjust;
+    handle.plan = resolved->plan;
+    handle.pin = Pin();
+    return handle;
+}
+
+bool MethodHandle::IsValid() const {
+    return info != nullptr;
+}
+
+MethodHandle::operator bool() const {
+    return IsValid();
+}
+
+const MethodInfo* MethodHandle::GetMethodInfo() const {
+    return info;
+}
+
+SharedObject MethodHandle::Invoke(void* instance, std::span<void* const> params) const {
+    if (!IsValid()) {
+        return SharedObject();
+    }
+    if (params.size() != info->argsList.size()) {
+        std::cerr << "Error: " << info->name << " takes " << info->argsList.size() << " arguments, " << params.size() << " given" << std::endl;
+        return SharedObject();
+    }
+    SharedObject ret;
+    info->getRegister(adjust(instance), params, ret);
+    if (ret.GetType().getHash() == TypeID::get<ReflMgr::Any>().getHash()) {
+        return ret.As<ReflMgr::Any>().ToSharedPtr();
+    }
+    return ret;
+}
+
+SharedObject MethodHandle::Invoke(ObjectPtr instance, const std::vector<ObjectPtr>& params) const {
+    return Call(instance, params);
+}
+
+SharedObject MethodHandle::InvokeStatic(const std::vector<ObjectPtr>& params) const {
+    return Call(ObjectPtr{ TypeID::get<void>(), nullptr }, params);
+}
+
+SharedObject MethodHandle::Call(ObjectPtr instance, std::span<const ObjectPtr> params) const {
+    if (!IsValid()) {
+        return SharedObject();
+    }
+    if (params.size() != plan.size()) {
+        std::cerr << "Error: " << info->name << " takes " << plan.size() << " arguments, " << params.size() << " given" << std::endl;
+        return SharedObject();
+    }
+    SmallBuffer<void*> args;
+    SmallBuffer<TypeID::ConvertSlot> temp;
+    ReflMgr::PrepareArgs(*info, plan, params, args, temp);
+    return Invoke(instance.GetRawPtr(), args);
+}
+
+InvokeCache::InvokeCache(std::string_view method) : method(method) {}
+
+size_t InvokeCache::SignatureOf(const std::vector<ObjectPtr>& params) {
+    size_t hash = params.size();
+    for (const auto& param : params) {
+        hash ^= param.GetType().getHash() + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+SharedObject InvokeCache::Invoke(ObjectPtr instance, const std::vector<ObjectPtr>& params, bool showError) {
+    auto& mgr = ReflMgr::Instance();
+    if (version != mgr.GetVersion()) {
+        Clear();
+        version = mgr.GetVersion();
+    }
+    TypeID type = instance.GetType();
+    size_t signature = SignatureOf(params);
+    for (int i = 0; i < used; i++) {
+        auto& entry = entries[i];
+        if (entry.signature == signature && entry.type == type && std::equal(params.begin(), params.end(), entry.args.begin(), entry.args.end(), [](const ObjectPtr& param, TypeID arg) { return param.GetType() == arg; })) {
+            hits++;
+            return entry.handle.Invoke(instance, params);
+        }
+    }
+    misses++;
+    ArgsTypeList list;
+    for (const auto& param : params) {
+        list.push_back(param.GetType());
+    }
+    auto handle = mgr.GetMethodHandle(instance.GetType(), method, list, showError);
+    if (!handle) {
+        return SharedObject();
+    }
+    Entry* entry = &entries[next];
+    if (used < Ways) {
+        entry = &entries[used++];
+    } else {
+        next = (next + 1) % Ways;
+    }
+    *entry = { signature, type, std::move(list), handle };
+    return entry->handle.Invoke(instance, params);
+}
+
+size_t InvokeCache::Hits() const {
+    return hits;
+}
+
+size_t InvokeCache::Misses() const {
+    return misses;
+}
+
+void InvokeCache::Clear() {
+    for (auto& entry : entries) {
+        entry = Entry();
+    }
+    used = 0;
+    next = 0;
+}
+
+void ReflMgr::PrepareArgs(const MethodInfo& info, std::span<const MethodHandle::ArgMode> plan, std::span<const ObjectPtr> params, SmallBuffer<void*>& args, SmallBuffer<TypeID::ConvertSlot>& temp) {
+    temp.reserve(temp.size() + plan.size());
+    for (int i = 0; i < plan.size(); i++) {
+        switch (plan[i]) {
+            case MethodHandle::ArgMode::Direct:
+                args.push_back(params[i].GetRawPtr());
+                break;
+            case MethodHandle::ArgMode::Generic:
+                args.push_back((void*)&params[i]);
+                break;
+            case MethodHandle::ArgMode::Convert:
+                args.push_back(params[i].GetType().implicitConvertInto(params[i].GetRawPtr(), info.argsList[i], temp.emplace_back()));
+                break;
+        }
+    }
+}
+
+SharedObject ReflMgr::Apply(const MethodInfo& info, std::span<const MethodHandle::ArgMode> plan, void* instance, std::span<const ObjectPtr> params) {
+    SmallBuffer<void*> args;
+    SmallBuffer<TypeID::ConvertSlot> temp;
+    PrepareArgs(info, plan, params, args, temp);
+    SharedObject ret;
+    info.getRegister(instance, args, ret);
+    if (ret.GetType().getHash() == TypeID::get<Any>().getHash()) {
+        return ret.As<Any>().ToSharedPtr();
+    }
+    return ret;
+}
+
+SharedObject ReflMgr::Call(ObjectPtr instance, MemberName method, std::span<const ObjectPtr> params, bool showError) {
+    SmallBuffer<TypeID> list;
+    for (const auto& param : params) {
+        list.push_back(param.GetType());
+    }
+    ReadGuard guard;
+    auto* resolved = ResolveMethod(instance.GetType(), method, list, showError);
+    if (resolved == nullptr || resolved->info->name == "") {
+        return SharedObject();
+    }
+    return Apply(*resolved->info, resolved->plan, resolved->adjust(instance.GetRawPtr()), params);
+}
+
+SharedObject ReflMgr::CallStatic(TypeID type, MemberName method, std::span<const ObjectPtr> params, bool showError) {
+    SmallBuffer<TypeID> list;
+    for (const auto& param : params) {
+        list.push_back(param.GetType());
+    }
+    ReadGuard guard;
+    auto* resolved = ResolveMethod(type, method, list, showError);
+    if (resolved == nullptr) {
+        return SharedObject();
+    }
+    return Apply(*resolved->info, resolved->plan, nullptr, params);
+}
+
+bool ReflMgr::InvokeBatch(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns, bool showError) {
+    return RawInvokeBatch(method, receivers, argColumns, TypeID::get<void>(), nullptr, nullptr, showError);
+}
+
+bool ReflMgr::ParallelInvokeBatch(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns, bool showError) {
+    return RawInvokeBatch(method, receivers, argColumns, TypeID::get<void>(), nullptr, nullptr, showError, true);
+}
+
+bool ReflMgr::RawInvokeBatch(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns, TypeID retType, void* column, void (*store)(void*, size_t, void*), bool showError, bool parallel) {
+    for (const auto& arg : argColumns) {
+        if (arg.size() != receivers.size()) {
+            ERROR << "Error: argument column of " << arg.size() << " values for " << receivers.size() << " receivers" << std::endl;
+            return false;
+        }
+    }
+    if (!parallel) {
+        return InvokeRange(method, receivers, argColumns, retType, column, store, 0, receivers.size(), showError);
+    }
+    // every chunk resolves and converts with its own scratch, results land at their own index
+    auto& pool = ThreadPool::Instance();
+    size_t grain = std::max<size_t>(1024, receivers.size() / (pool.Size() * 8 + 8));
+    std::atomic<bool> ok = true;
+    pool.ParallelFor(receivers.size(), grain, [&](size_t begin, size_t end) {
+        if (ok.load(std::memory_order_relaxed) && !InvokeRange(method, receivers, argColumns, retType, column, store, begin, end, showError)) {
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+bool ReflMgr::InvokeRange(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns, TypeID retType, void* column, void (*store)(void*, size_t, void*), size_t begin, size_t end, bool showError) {
+    // one resolution per distinct receiver and argument types
+    struct Target {
+        TypeID type;
+        std::vector<TypeID> args;
+        Resolution resolved;
+    };
+    std::vector<Target> targets;
+    SmallBuffer<ObjectPtr> row;
+    SmallBuffer<TypeID> types;
+    SmallBuffer<void*> args;
+    SmallBuffer<TypeID::ConvertSlot> temp;
+    TypeID::ConvertSlot result;
+    ReadGuard guard;
+    for (size_t i = begin; i < end; i++) {
+        row.clear();
+        for (const auto& arg : argColumns) {
+            row.push_back(arg[i]);
+        }
+        const Target* target = nullptr;
+        for (const auto& t : targets) {
+            if (t.type == receivers[i].GetType() && std::equal(row.begin(), row.end(), t.args.begin(), t.args.end(), [](const ObjectPtr& arg, TypeID type) { return arg.GetType() == type; })) {
+                target = &t;
+                break;
+            }
+        }
+        if (target == nullptr) {
+            types.clear();
+            for (const auto& arg : row) {
+                types.push_back(arg.GetType());
+            }
+            auto* resolved = ResolveMethod(receivers[i].GetType(), method, types, showError);
+            if (resolved == nullptr || resolved->info->name == "") {
+                return false;
+            }
+            if (store != nullptr && resolved->info->returnType.getHash() != retType.getHash() && (resolved->info->returnType.numericIndex() < 0 || retType.numericIndex() < 0)) {
+                ERROR << "Error: " << resolved->info->name << " returns " << resolved->info->returnType.getName() << ", cannot store into " << retType.getName() << std::endl;
+                return false;
+            }
+            targets.push_back({ receivers[i].GetType(), { types.begin(), types.end() }, *resolved });
+            target = &targets.back();
+        }
+        const MethodInfo& info = *target->resolved.info;
+        args.clear();
+        temp.clear();
+        PrepareArgs(info, target->resolved.plan, row, args, temp);
+        SharedObject ret;
+        info.getRegister(target->resolved.adjust(receivers[i].GetRawPtr()), args, ret);
+        if (store == nullptr) {
+            continue;
+        }
+        if (ret.GetType().getHash() == TypeID::get<Any>().getHash()) {
+            ret = ret.As<Any>().ToSharedPtr();
+        }
+        void* value = ret.GetRawPtr();
+        if (ret.GetType().getHash() != retType.getHash()) {
+            if (ret.GetType().numericIndex() < 0 || retType.numericIndex() < 0) {
+                ERROR << "Error: " << info.name << " returned " << ret.GetType().getName() << ", cannot store into " << retType.getName() << std::endl;
+                return false;
+            }
+            value = ret.GetType().implicitConvertInto(value, retType, result);
+        }
+        store(column, i, value);
+    }
+    return true;
+}
+
 SharedObject ReflMgr::RawInvoke(TypeID type, void* instance, std::string_view member, ArgsTypeList list, std::vector<void*> params) {
-    std::function<void*(void*)> conv = [](void* orig) { return orig; };
-    auto* info = SafeGetMethodWithInherit(&conv, type, member, list);
-    if (info == nullptr || info->name == "") {
+    ReadGuard guard;
+    auto* resolved = ResolveMethod(type, member, list);
+    if (resolved == nullptr || resolved->info->name == "") {
         return SharedObject::Null;
     }
-    auto ret = info->newRet();
-    info->getRegister(conv(instance), params, ret);
+    SharedObject ret;
+    resolved->info->getRegister(resolved->adjust(instance), params, ret);
     return ret;
 }
 
+SharedObject ReflMgr::InvokeOperator(ObjectPtr instance, MetaMethods::Op op, std::span<const ObjectPtr> params, bool showError) {
+    ReadGuard guard;
+    auto slot = FindOperator(instance.GetType(), op);
+    // only an exact match on the most derived level can skip overload resolution
+    if (!slot.empty()) {
+        for (auto& info : *slot[0].overloads) {
+            if (info.argsList.size() != params.size()) {
+                continue;
+            }
+            bool same = true;
+            for (int i = 0; i < params.size() && same; i++) {
+                same = info.argsList[i].getHash() == params[i].GetType().getHash();
+            }
+            if (!same) {
+                continue;
+            }
+            SmallBuffer<void*> args;
+            for (const auto& param : params) {
+                args.push_back(param.GetRawPtr());
+            }
+            SharedObject ret;
+            info.getRegister(slot[0].adjust(instance.GetRawPtr()), args, ret);
+            if (ret.GetType().getHash() == TypeID::get<Any>().getHash()) {
+                return ret.As<Any>().ToSharedPtr();
+            }
+            return ret;
+        }
+    }
+    return Call(instance, MetaMethods::OpName(op), params, showError);
+}
+
+static size_t hookBit(TypeID type) {
+    size_t hash = type.getHash();
+    return (hash ^ (hash >> 12) ^ (hash >> 24)) & 4095;
+}
+
+bool ReflMgr::MayHaveHook(TypeID type, bool dtor) const {
+    size_t bit = hookBit(type);
+    return hookFilter[dtor][bit / 64].load(std::memory_order_acquire) & ((uint64_t)1 << (bit % 64));
+}
+
+// called by writers; also marks every class reaching type through parents
+// or aliases, since their lookups find the inherited hook
+void ReflMgr::MarkHook(TypeID type, bool dtor) {
+    size_t bit = hookBit(type);
+    hookFilter[dtor][bit / 64].fetch_or((uint64_t)1 << (bit % 64), std::memory_order_release);
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (auto& [id, info] : classInfo) {
+            if (MayHaveHook(id, dtor)) {
+                continue;
+            }
+            bool inherits = !info.aliasTo.isNull() && MayHaveHook(info.aliasTo, dtor);
+            for (auto& parent : info.parents) {
+                inherits |= MayHaveHook(parent, dtor);
+            }
+            if (inherits) {
+                size_t idBit = hookBit(id);
+                hookFilter[dtor][idBit / 64].fetch_or((uint64_t)1 << (idBit % 64), std::memory_order_release);
+                changed = true;
+            }
+        }
+    }
+}
+
+// called by writers once the class or one of its hooks is registered
+void ReflMgr::RecordHooks(TypeID type) {
+    auto* info = SafeGetList(classInfo, type);
+    if (info == nullptr) {
+        return;
+    }
+    auto own = [&](std::string_view name) -> const MethodInfo* {
+        auto symbol = Symbol::find(name);
+        auto* lst = symbol.isNull() ? nullptr : SafeGet(methodInfo, type, symbol);
+        if (lst != nullptr) {
+            for (auto& method : *lst) {
+                if (method.argsList.empty()) {
+                    return &method;
+                }
+            }
+        }
+        return nullptr;
+    };
+    info->construct = own(MetaMethods::operator_ctor);
+    info->destruct = own(MetaMethods::operator_dtor);
+}
+
+void ReflMgr::InheritHooks(TypeID type, TypeID from) {
+    for (bool dtor : { false, true }) {
+        if (MayHaveHook(from, dtor) && !MayHaveHook(type, dtor)) {
+            MarkHook(type, dtor);
+        }
+    }
+}
+
+void ReflMgr::Construct(ObjectPtr instance, std::span<const ObjectPtr> args) {
+    if (!MayHaveHook(instance.GetType(), false)) {
+        return;
+    }
+    ReadGuard guard;
+    auto* info = FindClass(instance.GetType());
+    if (args.empty() && info != nullptr && info->construct != nullptr) {
+        SharedObject ret;
+        info->construct->getRegister(instance.GetRawPtr(), {}, ret);
+        return;
+    }
+    if (FindOperator(instance.GetType(), MetaMethods::Op::ctor).empty()) {
+        return;
+    }
+    InvokeOperator(instance, MetaMethods::Op::ctor, args, false);
+}
+
+void ReflMgr::Destruct(ObjectPtr instance) {
+    if (!MayHaveHook(instance.GetType(), true)) {
+        return;
+    }
+    ReadGuard guard;
+    auto* info = FindClass(instance.GetType());
+    if (info != nullptr && info->destruct != nullptr) {
+        SharedObject ret;
+        info->destruct->getRegister(instance.GetRawPtr(), {}, ret);
+        return;
+    }
+    if (FindOperator(instance.GetType(), MetaMethods::Op::dtor).empty()) {
+        return;
+    }
+    InvokeOperator(instance, MetaMethods::Op::dtor, {}, false);
+}
+
 void ReflMgr::AddAliasClass(std::string_view from, std::string_view to) {
+    WriteBatch batch;
     classInfo[TypeID::getRaw(from)].aliasTo = TypeID::getRaw(to);
+    InheritHooks(TypeID::getRaw(from), TypeID::getRaw(to));
+    version++;
 }
 
 void ReflMgr::AddVirtualClass(std::string_view cls, std::function<SharedObject(const std::vector<ObjectPtr>&)> ctor, TagList tagList) {
+    WriteBatch batch;
     auto type = TypeID::getRaw(cls);
     classInfo[type].newObject = ctor;
     classInfo[type].tags = tagList;
+    version++;
 }
 
 void ReflMgr::AddVirtualInheritance(std::string_view cls, std::string_view inherit) {
+    WriteBatch batch;
     ClassInfo& info = classInfo[TypeID::getRaw(cls)];
     info.parents.push_back(TypeID::getRaw(inherit));
-    info.cast.push_back([](void* derived) -> void* {
-        return derived;
-    });
+    InheritHooks(TypeID::getRaw(cls), TypeID::getRaw(inherit));
+    version++;
+    info.cast.push_back({ 0 });
 }
 
-static inline TagList nullTag;
-
-TagList& ReflMgr::GetClassTag(TypeID cls) {
-    return classInfo[cls].tags;
+const TagList ReflMgr::GetClassTag(TypeID cls) {
+    ReadGuard guard;
+    auto* info = FindClass(cls);
+    return info == nullptr ? TagList{} : info->tags;
 }
-TagList& ReflMgr::GetFieldTag(TypeID cls, std::string_view name) {
-    return fieldInfo[cls][std::string{name}].tags;
+const TagList ReflMgr::GetFieldTag(TypeID cls, std::string_view name) {
+    ReadGuard guard;
+    ThisAdjust adjust;
+    auto* info = SafeGetFieldWithInherit(&adjust, cls, name, false);
+    return info == nullptr ? TagList{} : info->tags;
 }
-TagList& ReflMgr::GetMethodInfo(TypeID cls, std::string_view name) {
-    return methodInfo[cls][std::string{name}][0].tags;
+const TagList ReflMgr::GetMethodInfo(TypeID cls, std::string_view name) {
+    ReadGuard guard;
+    auto symbol = Symbol::find(name);
+    if (symbol.isNull()) {
+        return {};
+    }
+    for (auto& entry : FindMethods(cls, symbol)) {
+        if (!entry.overloads->empty()) {
+            return (*entry.overloads)[0].tags;
+        }
+    }
+    return {};
+}
+const TagList ReflMgr::GetMethodInfo(TypeID cls, std::string_view name, const ArgsTypeList& args) {
+    ReadGuard guard;
+    ThisAdjust adjust;
+    auto* info = SafeGetMethodWithInherit(&adjust, cls, name, args, false);
+    return info == nullptr ? TagList{} : info->tags;
+}
+void ReflMgr::SetClassTag(TypeID cls, TagList tags) {
+    WriteBatch batch;
+    classInfo[cls].tags = std::move(tags);
+    version++;
 }
-TagList& ReflMgr::GetMethodInfo(TypeID cls, std::string_view name, const ArgsTypeList& args) {
-    auto& infos = methodInfo[cls][std::string{name}];
+void ReflMgr::SetFieldTag(TypeID cls, std::string_view name, TagList tags) {
+    WriteBatch batch;
+    auto* field = SafeGet(fieldInfo, cls, Symbol::find(name));
+    if (field == nullptr) {
+        ERROR << "Error: no field " << cls.getName() << "::" << name << " to tag" << std::endl;
+        return;
+    }
+    field->tags = std::move(tags);
+    version++;
+}
+void ReflMgr::SetMethodTag(TypeID cls, std::string_view name, const ArgsTypeList& args, TagList tags) {
+    WriteBatch batch;
+    auto* methods = SafeGet(methodInfo, cls, Symbol::find(name));
     MethodInfo* rec[3] = { nullptr, nullptr, nullptr };
-    for (auto& info : infos) {
-        CheckParams(info, args, rec);
+    if (methods != nullptr) {
+        for (auto& info : *methods) {
+            CheckParams(info, args, rec);
+        }
     }
     for (int i = 0; i < 3; i++) {
         if (rec[i] != nullptr) {
-            return rec[i]->tags;
+            rec[i]->tags = std::move(tags);
+            version++;
+            return;
         }
     }
-    return nullTag;
+    ERROR << "Error: no method " << cls.getName() << "::" << name << " to tag" << std::endl;
 }
 
 void ReflMgr::RawAddField(TypeID cls, TypeID varType, std::string_view name, std::function<ObjectPtr(ObjectPtr)> func) {
+    WriteBatch batch;
     FieldInfo info{ std::string{name} };
-    auto& field = fieldInfo[cls][std::string{name}];
+    auto& field = fieldInfo[cls][Symbol::intern(name)];
+    version++;
     field = info.withRegister([func, cls](void* ptr) { return func(ObjectPtr{cls, ptr}); });
     field.varType = varType;
 }
 
 void ReflMgr::RawAddStaticField(TypeID cls, TypeID varType, std::string_view name, std::function<ObjectPtr()> func) {
+    WriteBatch batch;
     FieldInfo info{ std::string{name} };
-    auto& field = fieldInfo[cls][std::string{name}];
+    auto& field = fieldInfo[cls][Symbol::intern(name)];
+    version++;
     field = info.withRegister([func](void* ptr) { return func(); });
     field.varType = varType;
 }
@@ -327,8 +1245,7 @@ void ReflMgr::RawAddMethod(TypeID cls, std::string_view name, TypeID returnType,
     MethodInfo info{ std::string{name} };
     info.returnType = returnType;
     info.argsList = argsList;
-    info.newRet = []() { return SharedObject(); };
-    AddMethodInfo(cls, info.name, info.withRegister([func, argsList, cls](void* instance, const std::vector<void*>& params, SharedObject& ret) {
+    AddMethodInfo(cls, info.name, info.withRegister([func, argsList, cls](void* instance, std::span<void* const> params, SharedObject& ret) {
         std::vector<ObjectPtr> args;
         for (int i = 0; i < params.size(); i++) {
             args.push_back(ObjectPtr{argsList[i], params[i]});
@@ -338,21 +1255,14 @@ void ReflMgr::RawAddMethod(TypeID cls, std::string_view name, TypeID returnType,
 }
 
 SharedObject ReflMgr::RawInvoke(ObjectPtr instance, std::string_view name, const std::vector<ObjectPtr>& params) {
-    ArgsTypeList list;
-    std::vector<void*> args;
-    for (auto param : params) {
-        args.push_back(param.GetRawPtr());
-        list.push_back(param.GetType());
-    }
-    return RawInvoke(instance.GetType(), instance.GetRawPtr(), name, list, args);
+    return Call(instance, name, params);
 }
 
 void ReflMgr::RawAddStaticMethod(TypeID cls, std::string_view name, TypeID returnType, const ArgsTypeList& argsList, std::function<SharedObject(const std::vector<ObjectPtr>&)> func) {
     MethodInfo info{ std::string{name} };
     info.returnType = returnType;
     info.argsList = argsList;
-    info.newRet = []() { return SharedObject(); };
-    AddMethodInfo(cls, info.name, info.withRegister([func, argsList](void* instance, const std::vector<void*>& params, SharedObject& ret) {
+    AddMethodInfo(cls, info.name, info.withRegister([func, argsList](void* instance, std::span<void* const> params, SharedObject& ret) {
         std::vector<ObjectPtr> args;
         for (int i = 0; i < params.size(); i++) {
             args.push_back(ObjectPtr{argsList[i], params[i]});
@@ -378,47 +1288,59 @@ void ReflMgr::SelfExport() {
 }
 
 void ReflMgr::IterateField(TypeID cls, std::function<void(const FieldInfo&)> callback) {
-    std::function<void*(void*)> conv = [](void* orig) { return orig; };
     cls = GetType(cls.getName());
-    WalkThroughInherits(&conv, cls, std::function([&](TypeID type) -> FieldInfo* {
-        auto* lst = SafeGetList(fieldInfo, cls);
-        if (lst == nullptr) {
-            return nullptr;
+    ReadGuard guard;
+    if (auto* frozen = Current()) {
+        auto* info = frozen->FindClass(cls.getHash());
+        if (info == nullptr) {
+            return;
         }
-        for (auto& field : *lst) {
-            callback(field.second);
+        for (unsigned i = info->fieldBegin; i < info->fieldEnd; i++) {
+            callback(*frozen->fields[i].entry.info);
         }
-        return nullptr;
-    }));
+        return;
+    }
+    for (auto& field : GetMemberTable(cls).fields) {
+        callback(*field.second.info);
+    }
 }
 
 void ReflMgr::IterateMethod(TypeID cls, std::function<void(const MethodInfo&)> callback) {
-    std::function<void*(void*)> conv = [](void* orig) { return orig; };
     cls = GetType(cls.getName());
-    WalkThroughInherits(&conv, cls, std::function([&](TypeID type) -> MethodInfo* {
-        auto* lst = SafeGetList(methodInfo, cls);
-        if (lst == nullptr) {
-            return nullptr;
+    ReadGuard guard;
+    if (auto* frozen = Current()) {
+        auto* info = frozen->FindClass(cls.getHash());
+        if (info == nullptr) {
+            return;
         }
-        for (auto& method : *lst) {
-            for (auto& overloads : method.second) {
+        for (unsigned i = info->methodBegin; i < info->methodEnd; i++) {
+            for (auto& overloads : *frozen->methodEntries[frozen->methods[i].begin].overloads) {
                 callback(overloads);
             }
         }
-        return nullptr;
-    }));
+        return;
+    }
+    for (auto& method : GetMemberTable(cls).methods) {
+        for (auto& overloads : *method.second.front().overloads) {
+            callback(overloads);
+        }
+    }
 }
 
 bool ReflMgr::IsBaseClass(TypeID query, TypeID base) {
+    ReadGuard guard;
     std::queue<TypeID> q;
     q.push(query);
     while (!q.empty()) {
         if (q.front() == base) {
             return true;
         }
-        auto& info = classInfo[q.front()];
+        auto* info = FindClass(q.front());
         q.pop();
-        for (auto& id : info.parents) {
+        if (info == nullptr) {
+            continue;
+        }
+        for (auto& id : info->parents) {
             q.push(id);
         }
     }
@@ -1,10 +1,21 @@
 #pragma once
 #include <utility>
+#include <cstring>
+#include <atomic>
+#include <mutex>
 #include <queue>
+#include <deque>
+#include <new>
 #include <functional>
+#include <span>
+#include <array>
 #include "TemplateUtils.h"
 #include "Object.h"
 #include "TypeID.h"
+#include "Symbol.h"
+#include "SmallBuffer.h"
+#include "Trampoline.h"
+#include "ThreadPool.h"
 #include "MetaMethods.h"
 
 using TagList = std::unordered_map<std::string, std::vector<std::string>>;
@@ -13,8 +24,11 @@ struct FieldInfo {
     std::string name;
     TagList tags;
     TypeID varType;
-    std::function<ObjectPtr(void*)> getRegister;
-    FieldInfo& withRegister(std::function<ObjectPtr(void*)> getRegister);
+    Trampoline<ObjectPtr(void*)> getRegister;
+    // byte offset inside the owning class for standard layout types, -1 when
+    // the field can only be reached through getRegister
+    ptrdiff_t offset = -1;
+    FieldInfo& withRegister(Trampoline<ObjectPtr(void*)> getRegister);
 };
 
 struct ArgsTypeList : std::vector<TypeID> {
@@ -22,18 +36,165 @@ struct ArgsTypeList : std::vector<TypeID> {
     using std::vector<TypeID>::vector;
 };
 
+// Statically typed entry point of a registered method: thunk is really a
+// Ret (*)(const TypedCall&, void*, Args...) for the registered Ret(Args...),
+// data holds the member/function pointer and object a registered std::function.
+struct TypedCall {
+    size_t signature = 0;
+    void (*thunk)() = nullptr;
+    alignas(void*) unsigned char data[3 * sizeof(void*)] = {};
+    std::shared_ptr<const void> object;
+};
+
 struct MethodInfo {
-    using FuncType = void(void*, const std::vector<void*>&, SharedObject&);
+    using FuncType = void(void*, std::span<void* const>, SharedObject&);
     std::string name;
     TagList tags;
-    std::function<FuncType> getRegister;
-    std::function<SharedObject()> newRet;
+    Trampoline<FuncType> getRegister;
     TypeID returnType;
     ArgsTypeList argsList;
-    MethodInfo& withRegister(std::function<FuncType> getRegister);
+    TypedCall typed;
+    MethodInfo& withRegister(Trampoline<FuncType> getRegister);
     bool sameDeclareTo(const MethodInfo& other) const;
 };
 
+struct BaseCast {
+    ptrdiff_t offset = 0;
+    void* (*thunk)(void*) = nullptr;
+};
+
+struct ThisAdjust {
+    ptrdiff_t offset = 0;
+    Trampoline<void*(void*)> thunk;
+    void* operator()(void* instance) const {
+        if (thunk) {
+            instance = thunk(instance);
+        }
+        return instance == nullptr ? nullptr : (char*)instance + offset;
+    }
+    ThisAdjust Then(const BaseCast& next) const;
+};
+
+class MethodHandle {
+    public:
+        enum class ArgMode : unsigned char { Direct, Generic, Convert };
+    private:
+        friend class ReflMgr;
+        const MethodInfo* info = nullptr;
+        ThisAdjust adjust;
+        std::vector<ArgMode> plan;
+        std::shared_ptr<const void> pin;
+    public:
+        MethodHandle() = default;
+        bool IsValid() const;
+        const MethodInfo* GetMethodInfo() const;
+        SharedObject Invoke(void* instance, std::span<void* const> params) const;
+        SharedObject Invoke(ObjectPtr instance, const std::vector<ObjectPtr>& params = {}) const;
+        SharedObject InvokeStatic(const std::vector<ObjectPtr>& params = {}) const;
+        SharedObject Call(ObjectPtr instance, std::span<const ObjectPtr> params) const;
+        operator bool() const;
+};
+
+// Resolved field access. When the field and every base class on the way to
+// it have fixed offsets they are folded into one, and access is base + offset.
+class FieldHandle {
+    private:
+        friend class ReflMgr;
+        const FieldInfo* info = nullptr;
+        TypeID type;
+        ptrdiff_t offset = -1;
+        ThisAdjust adjust;
+        std::shared_ptr<const void> pin;
+    public:
+        FieldHandle() = default;
+        bool IsValid() const;
+        bool HasOffset() const;
+        ptrdiff_t GetOffset() const;
+        const FieldInfo* GetFieldInfo() const;
+        TypeID GetOwnerType() const;
+        ObjectPtr Get(void* instance) const;
+        ObjectPtr Get(ObjectPtr instance) const;
+        template<typename T>
+        T& Ref(void* instance) const {
+            if (offset >= 0) {
+                return *(T*)((char*)instance + offset);
+            }
+            return *(T*)Get(instance).GetRawPtr();
+        }
+        operator bool() const;
+};
+
+template<typename Sig>
+class TypedMethod;
+
+template<typename Ret, typename... Args>
+class TypedMethod<Ret(Args...)> {
+    static_assert(std::is_void_v<Ret> || std::is_default_constructible_v<Ret>,
+        "typed calls return Ret() when the method is missing, so Ret must be void or default-constructible");
+    private:
+        friend class ReflMgr;
+        TypedCall call;
+        ThisAdjust adjust;
+        std::shared_ptr<const void> pin;
+    public:
+        static Ret Apply(const TypedCall& call, void* instance, Args... args) {
+            return ((Ret (*)(const TypedCall&, void*, Args...))call.thunk)(call, instance, std::forward<Args>(args)...);
+        }
+        static Ret Missing() {
+            if constexpr (std::is_void<Ret>()) {
+                return;
+            } else {
+                return Ret();
+            }
+        }
+        TypedMethod() = default;
+        bool IsValid() const {
+            return call.thunk != nullptr;
+        }
+        operator bool() const {
+            return IsValid();
+        }
+        Ret operator () (void* instance, Args... args) const {
+            if (!IsValid()) {
+                return Missing();
+            }
+            return Apply(call, adjust(instance), std::forward<Args>(args)...);
+        }
+        Ret operator () (ObjectPtr instance, Args... args) const {
+            return (*this)(instance.GetRawPtr(), std::forward<Args>(args)...);
+        }
+        Ret InvokeStatic(Args... args) const {
+            return (*this)((void*)nullptr, std::forward<Args>(args)...);
+        }
+};
+
+class InvokeCache {
+    public:
+        static constexpr int Ways = 4;
+    private:
+        // the signature hash only filters; a hit also compares the types
+        struct Entry {
+            size_t signature = 0;
+            TypeID type;
+            std::vector<TypeID> args;
+            MethodHandle handle;
+        };
+        std::string method;
+        Entry entries[Ways];
+        int used = 0;
+        int next = 0;
+        size_t version = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+        static size_t SignatureOf(const std::vector<ObjectPtr>& params);
+    public:
+        InvokeCache(std::string_view method);
+        SharedObject Invoke(ObjectPtr instance, const std::vector<ObjectPtr>& params = {}, bool showError = true);
+        size_t Hits() const;
+        size_t Misses() const;
+        void Clear();
+};
+
 template<typename T>
 struct FieldType {
     T type;
@@ -42,47 +203,198 @@ struct FieldType {
     FieldType(T type, std::string_view name) : type(type), info({std::string{name}}) {}
 };
 
+// overloads of one name; a deque so that adding an overload leaves the
+// others, and the MethodInfo pointers that handles hold, in place
+using OverloadList = std::deque<MethodInfo>;
+
 struct ClassInfo {
     TypeID aliasTo;
     std::vector<TypeID> parents;
-    std::vector<std::function<void*(void*)>> cast;
+    std::vector<BaseCast> cast;
     TagList tags;
-    std::function<SharedObject(const std::vector<ObjectPtr>&)> newObject = 0;
+    Trampoline<SharedObject(const std::vector<ObjectPtr>&)> newObject;
+    // the class's own zero-argument __ctor/__dtor, called directly without
+    // resolving overloads
+    const MethodInfo* construct = nullptr;
+    const MethodInfo* destruct = nullptr;
 };
 
 class ReflMgr {
+    friend class MethodHandle;
     public:
         struct Any : ObjectPtr {
             using ObjectPtr::ObjectPtr;
             Any(ObjectPtr);
         };
     private:
-        ReflMgr() {}
+        ReflMgr();
         std::string errorMsgPrefix;
-        TypeIDMap<std::unordered_map<std::string, FieldInfo>> fieldInfo;
-        TypeIDMap<std::unordered_map<std::string, std::vector<MethodInfo>>> methodInfo;
+        TypeIDMap<SymbolMap<FieldInfo>> fieldInfo;
+        TypeIDMap<SymbolMap<OverloadList>> methodInfo;
         TypeIDMap<ClassInfo> classInfo;
+        std::atomic<size_t> version = 0;
+        // Types that may have __ctor (index 0) or __dtor (index 1) hooks of
+        // their own or through parents and aliases, as a bitset over their
+        // hashes. Construct and Destruct check it without a lock; bits are
+        // only ever set and a collision just takes the full lookup.
+        std::atomic<uint64_t> hookFilter[2][64] = {};
+        bool MayHaveHook(TypeID type, bool dtor) const;
+        void MarkHook(TypeID type, bool dtor);
+        void InheritHooks(TypeID type, TypeID from);
+        void RecordHooks(TypeID type);
+        // real, aligned storage to measure member and base offsets against;
+        // no T is ever constructed in it
+        template<typename T>
+        static T* OffsetProbe() {
+            alignas(T) static unsigned char storage[sizeof(T)];
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
         template<typename T, typename U>
         auto GetFieldRegisterFunc(T U::* p) {
             return [p](void* instance) {
                 return ObjectPtr{ TypeID::get<T>(), (void*)&((U*)(instance)->*p) };
             };
         }
+        struct FieldEntry {
+            const FieldInfo* info;
+            ThisAdjust adjust;
+        };
+        struct MethodEntry {
+            const OverloadList* overloads;
+            ThisAdjust adjust;
+        };
+        using OpSlots = std::array<std::span<const MethodEntry>, (size_t)MetaMethods::Op::Count>;
+        struct MemberTable {
+            size_t version = -1;
+            SymbolMap<FieldEntry> fields;
+            SymbolMap<std::vector<MethodEntry>> methods;
+            OpSlots ops;
+        };
+        struct Frozen;
+        std::atomic<const Frozen*> frozen = nullptr;
+        std::shared_ptr<const Frozen> current;
+        std::vector<std::pair<size_t, std::shared_ptr<const Frozen>>> retired;
+        std::atomic<size_t> publishedVersion = 0;
+        std::recursive_mutex writeMutex;
+        int writeDepth = 0;
+        void Publish();
+        void Reclaim();
+        const Frozen* Current() const;
+        std::shared_ptr<const void> Pin() const;
+        void BuildMemberTable(TypeID id, MemberTable& table, TypeIDMap<SymbolMap<FieldInfo>>& fields, TypeIDMap<SymbolMap<OverloadList>>& methods, TypeIDMap<ClassInfo>& classes);
+        // Before Freeze, each thread builds and keeps its own tables, so readers
+        // share no lock and a table is only rebuilt by the thread using it.
+        const MemberTable& GetMemberTable(TypeID id);
+        const ClassInfo* FindClass(TypeID id);
+        const FieldEntry* FindField(TypeID id, Symbol name);
+        std::span<const MethodEntry> FindMethods(TypeID id, Symbol name);
+        std::span<const MethodEntry> FindOperator(TypeID id, MetaMethods::Op op);
         template<typename T> T* SafeGetList(TypeIDMap<T>& info, TypeID id);
-        template<typename T> T* SafeGet(TypeIDMap<std::unordered_map<std::string, T>>& info, TypeID id, std::string_view name);
+        template<typename T> T* SafeGet(TypeIDMap<SymbolMap<T>>& info, TypeID id, Symbol name);
         template<typename MethodInfoType>
-        void CheckParams(MethodInfoType& info, const ArgsTypeList& list, MethodInfoType** rec, bool showError = false);
-        const MethodInfo* SafeGet(TypeID id, std::string_view name, const ArgsTypeList& args);
-        template<typename Ret> Ret* WalkThroughInherits(std::function<void*(void*)>* instanceConv, TypeID id, std::function<Ret*(TypeID)> func);
-        const FieldInfo* SafeGetFieldWithInherit(std::function<void*(void*)>* instanceConv, TypeID id, std::string_view name, bool showError = true);
-        const MethodInfo* SafeGetMethodWithInherit(std::function<void*(void*)>* instanceConv, TypeID id, std::string_view name, const ArgsTypeList& args, bool showError = true);
+        void CheckParams(MethodInfoType& info, std::span<const TypeID> list, MethodInfoType** rec, bool showError = false);
+        const MethodInfo* ResolveOverload(const OverloadList& overloads, std::span<const TypeID> args, bool showError);
+        const FieldInfo* SafeGetFieldWithInherit(ThisAdjust* adjust, TypeID id, MemberName name, bool showError = true);
+        const MethodInfo* SafeGetMethodWithInherit(ThisAdjust* adjust, TypeID id, MemberName name, std::span<const TypeID> args, bool showError = true);
+        struct Resolution {
+            const MethodInfo* info = nullptr;
+            ThisAdjust adjust;
+            std::vector<MethodHandle::ArgMode> plan;
+        };
+        struct ResolveMemo;
+        // memoized SafeGetMethodWithInherit, the result lives until the next call on this thread
+        const Resolution* ResolveMethod(TypeID id, MemberName name, std::span<const TypeID> args, bool showError = true);
+        static void BuildPlan(const MethodInfo& info, std::span<const TypeID> args, std::vector<MethodHandle::ArgMode>& plan);
         void AddMethodInfo(TypeID type, const std::string& name, MethodInfo info, bool overridePrevious = true);
+        const TypedCall* FindTypedCall(ThisAdjust* adjust, TypeID type, MemberName name, TypeID signature, bool showError);
+        template<typename P, typename Type, typename Ret, typename... Args>
+        static Ret TypedMemberThunk(const TypedCall& call, void* instance, Args... args) {
+            P p;
+            std::memcpy(&p, call.data, sizeof(P));
+            return ((Type*)instance->*p)(std::forward<Args>(args)...);
+        }
+        template<typename Ret, typename... Args>
+        static Ret TypedFunctionThunk(const TypedCall& call, void*, Args... args) {
+            Ret (*p)(Args...);
+            std::memcpy(&p, call.data, sizeof(p));
+            return p(std::forward<Args>(args)...);
+        }
+        template<typename Type, typename Ret, typename... Args>
+        static Ret TypedLambdaThunk(const TypedCall& call, void* instance, Args... args) {
+            return (*(const std::function<Ret(Type*, Args...)>*)call.object.get())((Type*)instance, std::forward<Args>(args)...);
+        }
+        template<typename Ret, typename... Args>
+        static Ret TypedStaticLambdaThunk(const TypedCall& call, void*, Args... args) {
+            return (*(const std::function<Ret(Args...)>*)call.object.get())(std::forward<Args>(args)...);
+        }
+        template<typename P, typename Ret, typename Type, typename... Args>
+        static TypedCall GetMemberTypedCall(P p) {
+            static_assert(sizeof(P) <= sizeof(TypedCall::data));
+            TypedCall call;
+            call.signature = TypeID::get<Ret(Args...)>().getHash();
+            call.thunk = (void (*)())&TypedMemberThunk<P, Type, Ret, Args...>;
+            std::memcpy(call.data, &p, sizeof(P));
+            return call;
+        }
+        template<typename Ret, typename Type, typename... Args>
+        static TypedCall GetTypedCall(Ret (Type::* p)(Args...)) {
+            return GetMemberTypedCall<decltype(p), Ret, Type, Args...>(p);
+        }
+        template<typename Ret, typename Type, typename... Args>
+        static TypedCall GetTypedCall(Ret (Type::* p)(Args...) const) {
+            return GetMemberTypedCall<decltype(p), Ret, Type, Args...>(p);
+        }
+        template<typename Type, typename Ret, typename... Args>
+        static TypedCall GetTypedCall(std::function<Ret(Type*, Args...)> func) {
+            TypedCall call;
+            call.signature = TypeID::get<Ret(Args...)>().getHash();
+            call.thunk = (void (*)())&TypedLambdaThunk<Type, Ret, Args...>;
+            call.object = std::make_shared<std::function<Ret(Type*, Args...)>>(std::move(func));
+            return call;
+        }
+        template<typename Ret, typename... Args>
+        static TypedCall GetStaticTypedCall(Ret (*p)(Args...)) {
+            TypedCall call;
+            call.signature = TypeID::get<Ret(Args...)>().getHash();
+            call.thunk = (void (*)())&TypedFunctionThunk<Ret, Args...>;
+            std::memcpy(call.data, &p, sizeof(p));
+            return call;
+        }
+        template<typename Ret, typename... Args>
+        static TypedCall GetStaticTypedCall(std::function<Ret(Args...)> func) {
+            TypedCall call;
+            call.signature = TypeID::get<Ret(Args...)>().getHash();
+            call.thunk = (void (*)())&TypedStaticLambdaThunk<Ret, Args...>;
+            call.object = std::make_shared<std::function<Ret(Args...)>>(std::move(func));
+            return call;
+        }
     public:
+        class ReadGuard {
+            public:
+                ReadGuard();
+                ~ReadGuard();
+                ReadGuard(const ReadGuard&) = delete;
+        };
+        // Registration is only safe to run next to readers once the registry
+        // is frozen: before Freeze() lookups read the maps writers modify.
+        // After it, the outermost WriteBatch publishes a new snapshot, which
+        // copies the whole registry, so a plugin should register everything
+        // inside one batch.
+        class WriteBatch {
+            public:
+                WriteBatch();
+                ~WriteBatch();
+                WriteBatch(const WriteBatch&) = delete;
+        };
         ReflMgr(const ReflMgr&) = delete;
         ReflMgr(ReflMgr&&) = delete;
         ReflMgr(ReflMgr&) = delete;
+        ~ReflMgr();
         void SetErrorMsgPrefix(const std::string& msg);
         static ReflMgr& Instance();
+        size_t GetVersion() const;
+        void Freeze();
+        bool IsFrozen() const;
         static TypeID GetType(std::string_view clsName);
         bool HasClassInfo(TypeID type);
         SharedObject New(TypeID type, const std::vector<ObjectPtr>& args = {});
@@ -93,9 +405,15 @@ class ReflMgr {
         }
         template<typename T, typename U>
         void AddField(U T::* type, FieldInfo info) {
-            auto& field = fieldInfo[TypeID::get<T>()][info.name];
+            WriteBatch batch;
+            auto& field = fieldInfo[TypeID::get<T>()][Symbol::intern(info.name)];
+            version++;
             field = info.withRegister(GetFieldRegisterFunc(type));
             field.varType = TypeID::get<U>();
+            if constexpr (std::is_standard_layout_v<T>) {
+                T* obj = OffsetProbe<T>();
+                field.offset = reinterpret_cast<char*>(&(obj->*type)) - reinterpret_cast<char*>(obj);
+            }
         }
         template<typename T, typename U>
         void AddField(U T::* type, std::string_view name) {
@@ -113,7 +431,9 @@ class ReflMgr {
         }
         template<typename T>
         void AddStaticField(TypeID type, T* ptr, FieldInfo info) {
-            auto& field = fieldInfo[type][std::string{info.name}];
+            WriteBatch batch;
+            auto& field = fieldInfo[type][Symbol::intern(info.name)];
+            version++;
             field = info.withRegister([ptr](void*) -> SharedObject {
                 return SharedObject{ TypeID::get<T>(), (void*)ptr };
             });
@@ -135,46 +455,30 @@ class ReflMgr {
             AddStaticField<T0>(type, info.type, info.info);
             AddStaticField<T0>(type, args...);
         }
-        ObjectPtr RawGetField(TypeID type, void* instance, std::string_view member);
+        ObjectPtr RawGetField(TypeID type, void* instance, MemberName member);
+        FieldHandle GetFieldHandle(TypeID type, MemberName member, bool showError = true);
         template<typename T>
-        ObjectPtr GetField(T instance, std::string_view member) {
+        ObjectPtr GetField(T instance, MemberName member) {
             return RawGetField(instance.GetType(), instance.GetRawPtr(), member);
         }
-    private:
-        template<typename Func>
-        auto GetNewRet(Func func) {
-            using Ret = typename MethodTraits<Func>::ReturnType;
-            if constexpr (std::is_same<void, Ret>() || std::is_reference<Ret>()) {
-                return []() { return SharedObject(); };
-            } else {
-                return []() { return SharedObject::New<Ret>(); };
-            }
-        }
-        template<typename Ret, typename... Args>
-        auto GetNewRet(std::function<Ret(Args...)> func) {
-            if constexpr (std::is_same<void, Ret>() || std::is_reference<Ret>()) {
-                return []() { return SharedObject(); };
-            } else {
-                return []() { return SharedObject::New<Ret>(); };
-            }
-        }
     public:
 #define DEF_METHOD_REG(end)                                                                                                     \
     private:                                                                                                                    \
         template<typename Ret, typename Type, typename... Args, size_t... N>                                                    \
         auto GetMethodRegisterFunc(Ret (Type::* p)(Args...) end, std::index_sequence<N...> is) {                                \
-            return [p](void* instance, const std::vector<void*>& params, SharedObject& ret) {                                   \
-                ret.As<Ret>() =                                                                                                 \
+            return [p](void* instance, std::span<void* const> params, SharedObject& ret) {                                      \
+                ret.Emplace<Ret>(                                                                                               \
                     ((Type*)instance->*p)(                                                                                      \
                         (                                                                                                       \
                             *(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))                         \
                         )...                                                                                                    \
-                    );                                                                                                          \
+                    )                                                                                                           \
+                );                                                                                                              \
             };                                                                                                                  \
         }                                                                                                                       \
         template<typename Type, typename... Args, size_t... N>                                                                  \
         auto GetMethodRegisterFunc(void (Type::* p)(Args...) end, std::index_sequence<N...> is) {                               \
-            return [p](void* instance, const std::vector<void*>& params, SharedObject& ret) {                                   \
+            return [p](void* instance, std::span<void* const> params, SharedObject& ret) {                                      \
                 ((Type*)instance->*p)(                                                                                          \
                     (*(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N])))...                            \
                 );                                                                                                              \
@@ -182,7 +486,7 @@ class ReflMgr {
         }                                                                                                                       \
         template<typename Ret, typename Type, typename... Args, size_t... N>                                                    \
         auto GetMethodRegisterFunc(Ret& (Type::* p)(Args...) end, std::index_sequence<N...> is) {                               \
-            return [p](void* instance, const std::vector<void*>& params, SharedObject& ret) {                                   \
+            return [p](void* instance, std::span<void* const> params, SharedObject& ret) {                                      \
                 ret = SharedObject{ TypeID::get<Ret&>(),                                                                        \
                     (void*)(                                                                                                    \
                         &(((Type*)instance->*p)(                                                                                \
@@ -205,7 +509,7 @@ class ReflMgr {
         void AddMethod(Ret (Type::* func)(Args...) end, MethodInfo info) {                                                      \
             info.returnType = TypeID::get<Ret>();                                                                               \
             info.argsList = ArgsTypeList{TypeID::get<Args>()...};                                                               \
-            info.newRet = GetNewRet(func);                                                                                      \
+            info.typed = GetTypedCall(func);                                                                                    \
             AddMethodInfo(TypeID::get<Type>(), info.name, info.withRegister(GetMethodRegisterFunc(func)));                      \
         }                                                                                                                       \
         template<typename Ret, typename Type, typename... Args>                                                                 \
@@ -217,14 +521,14 @@ class ReflMgr {
         void AddMethod(std::function<Ret(Type*, Args...)> func, MethodInfo info) {
             info.returnType = TypeID::get<Ret>();
             info.argsList = ArgsTypeList{TypeID::get<Args>()...};
-            info.newRet = GetNewRet(func);
+            info.typed = GetTypedCall(func);
             AddMethodInfo(TypeID::get<Type>(), info.name, info.withRegister(GetLambdaRegisterFunc(func)));
         }
         template<typename Ret, typename... Args>
         void AddStaticMethod(TypeID type, std::function<Ret(Args...)> func, MethodInfo info) {
             info.returnType = TypeID::get<Ret>();
             info.argsList = ArgsTypeList{TypeID::get<Args>()...};
-            info.newRet = GetNewRet(func);
+            info.typed = GetStaticTypedCall(func);
             AddMethodInfo(type, info.name, info.withRegister(GetLambdaRegisterStaticFunc(func)));
         }
         template<typename Type, typename Ret, typename... Args>
@@ -243,20 +547,20 @@ class ReflMgr {
     private:
         template<typename Type, typename Ret, typename... Args, size_t... N>
         auto GetLambdaRegisterFunc(std::function<Ret(Type*, Args...)> func, std::index_sequence<N...> is) {
-            return [func](void* instance, const std::vector<void*>& params, SharedObject& ret) {
-                ret.As<Ret>() = func((Type*)instance, *(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...);
+            return [func](void* instance, std::span<void* const> params, SharedObject& ret) {
+                ret.Emplace<Ret>(func((Type*)instance, *(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...));
             };
         }
         template<typename Type, typename... Args, size_t... N>
         auto GetLambdaRegisterFunc(std::function<void(Type*, Args...)> func, std::index_sequence<N...> is) {
-            return [func](void* instance, const std::vector<void*>& params, SharedObject& ret) {
+            return [func](void* instance, std::span<void* const> params, SharedObject& ret) {
                 func((Type*)instance, *(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...);
                 ret = SharedObject();
             };
         }
         template<typename Type, typename Ret, typename... Args, size_t... N>
         auto GetLambdaRegisterFunc(std::function<Ret&(Type*, Args...)> func, std::index_sequence<N...> is) {
-            return [func](void* instance, const std::vector<void*>& params, SharedObject& ret) {
+            return [func](void* instance, std::span<void* const> params, SharedObject& ret) {
                 ret = SharedObject{ TypeID::get<Ret&>(),
                     (void*)(
                         &(func((Type*)instance, *(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...))
@@ -272,19 +576,19 @@ class ReflMgr {
         }
         template<typename Ret, typename... Args, size_t... N>
         auto GetLambdaRegisterStaticFunc(std::function<Ret(Args...)> func, std::index_sequence<N...> is) {
-            return [func](void*, const std::vector<void*>& params, SharedObject& ret) {
-                ret.As<Ret>() = func(*(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...);
+            return [func](void*, std::span<void* const> params, SharedObject& ret) {
+                ret.Emplace<Ret>(func(*(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...));
             };
         }
         template<typename... Args, size_t... N>
         auto GetLambdaRegisterStaticFunc(std::function<void(Args...)> func, std::index_sequence<N...> is) {
-            return [func](void*, const std::vector<void*>& params, SharedObject& ret) {
+            return [func](void*, std::span<void* const> params, SharedObject& ret) {
                 func(*(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...);
             };
         }
         template<typename Ret, typename... Args, size_t... N>
         auto GetLambdaRegisterStaticFunc(std::function<Ret&(Args...)> func, std::index_sequence<N...> is) {
-            return [func](void*, const std::vector<void*>& params, SharedObject& ret) {
+            return [func](void*, std::span<void* const> params, SharedObject& ret) {
                 ret = SharedObject{ TypeID::get<Ret&>(),
                     (void*)(
                         &(func(*(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...))
@@ -300,19 +604,19 @@ class ReflMgr {
         }
         template<typename Ret, typename... Args, size_t... N>
         auto GetStaticMethodRegisterFunc(Ret (*func)(Args...), std::index_sequence<N...> is) {
-            return [func](void*, const std::vector<void*>& params, SharedObject& ret) {
-                ret.As<Ret>() = func(*(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...);
+            return [func](void*, std::span<void* const> params, SharedObject& ret) {
+                ret.Emplace<Ret>(func(*(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...));
             };
         }
         template<typename... Args, size_t... N>
         auto GetStaticMethodRegisterFunc(void (*func)(Args...), std::index_sequence<N...> is) {
-            return [func](void*, const std::vector<void*>& params, SharedObject& ret) {
+            return [func](void*, std::span<void* const> params, SharedObject& ret) {
                 func(*(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...);
             };
         }
         template<typename Ret, typename... Args, size_t... N>
         auto GetStaticMethodRegisterFunc(Ret& (*func)(Args...), std::index_sequence<N...> is) {
-            return [func](void*, const std::vector<void*>& params, SharedObject& ret) {
+            return [func](void*, std::span<void* const> params, SharedObject& ret) {
                 ret = SharedObject{ TypeID::get<Ret&>(),
                     (void*)(
                         &(func(*(reinterpret_cast<typename std::remove_reference<Args>::type*>(params[N]))...))
@@ -326,29 +630,14 @@ class ReflMgr {
                 std::make_index_sequence<Count<TypeList<Args...>>::count>()
             );
         }
-        template<typename T>
-        std::vector<void*> ConvertParams(const std::vector<T>& params, const MethodInfo& info, std::vector<std::shared_ptr<void>>& temp) {
-            std::vector<void*> ret;
-            for (int i = 0; i < info.argsList.size(); i++) {
-                if (info.argsList[i].getHash() == TypeID::get<ReflMgr::Any>().getHash()) {
-                    ret.push_back((void*)&params[i]);
-                    continue;
-                }
-                if (info.argsList[i].getHash() != params[i].GetType().getHash()) {
-                    temp.push_back(params[i].GetType().implicitConvertInstance(params[i].GetRawPtr(), info.argsList[i]));
-                    ret.push_back(temp[temp.size() - 1].get());
-                    continue;
-                }
-                ret.push_back(params[i].GetRawPtr());
-            }
-            return ret;
-        }
+        static void PrepareArgs(const MethodInfo& info, std::span<const MethodHandle::ArgMode> plan, std::span<const ObjectPtr> params, SmallBuffer<void*>& args, SmallBuffer<TypeID::ConvertSlot>& temp);
+        SharedObject Apply(const MethodInfo& info, std::span<const MethodHandle::ArgMode> plan, void* instance, std::span<const ObjectPtr> params);
     public:
         template<typename Ret, typename... Args>
         void AddStaticMethod(TypeID type, Ret (*func)(Args...), MethodInfo info) {
             info.returnType = TypeID::get<Ret>();
             info.argsList = ArgsTypeList{TypeID::get<Args>()...};
-            info.newRet = GetNewRet(func);
+            info.typed = GetStaticTypedCall(func);
             AddMethodInfo(type, info.name, info.withRegister(GetStaticMethodRegisterFunc(std::forward<decltype(func)>(func))));
         }
         template<typename Ret, typename... Args>
@@ -357,54 +646,104 @@ class ReflMgr {
             AddStaticMethod(type, func, info);
         }
         std::function<void(void*, std::vector<void*>, SharedObject&)> GetInvokeFunc(TypeID type, std::string_view member, ArgsTypeList list);
+        MethodHandle GetMethodHandle(TypeID type, MemberName member, const ArgsTypeList& list, bool showError = true);
         SharedObject RawInvoke(TypeID type, void* instance, std::string_view member, ArgsTypeList list, std::vector<void*> params);
-        template<typename T = ObjectPtr, typename U>
-        SharedObject Invoke(U instance, std::string_view method, const std::vector<T>& params, bool showError = true) {
-            ArgsTypeList list;
-            for (auto param : params) {
-                list.push_back(param.GetType());
+        SharedObject InvokeOperator(ObjectPtr instance, MetaMethods::Op op, std::span<const ObjectPtr> params, bool showError = true);
+        void Construct(ObjectPtr instance, std::span<const ObjectPtr> args);
+        void Destruct(ObjectPtr instance);
+        SharedObject Call(ObjectPtr instance, MemberName method, std::span<const ObjectPtr> params, bool showError = true);
+        SharedObject CallStatic(TypeID type, MemberName method, std::span<const ObjectPtr> params, bool showError = true);
+        // argColumns[i][j] is the i-th argument for receivers[j]; store(column, j, value) receives a Ret* for row j
+        using ArgColumns = std::span<const std::span<const ObjectPtr>>;
+        bool RawInvokeBatch(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns, TypeID retType, void* column, void (*store)(void*, size_t, void*), bool showError = true, bool parallel = false);
+        bool InvokeBatch(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns = {}, bool showError = true);
+        template<typename Ret>
+        bool InvokeBatch(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns, std::span<Ret> out, bool showError = true) {
+            return InvokeBatchInto(method, receivers, argColumns, out, showError, false);
+        }
+        // same as InvokeBatch, with the receivers split into chunks run on ThreadPool::Instance()
+        bool ParallelInvokeBatch(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns = {}, bool showError = true);
+        template<typename Ret>
+        bool ParallelInvokeBatch(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns, std::span<Ret> out, bool showError = true) {
+            return InvokeBatchInto(method, receivers, argColumns, out, showError, true);
+        }
+    private:
+        template<typename Ret>
+        bool InvokeBatchInto(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns, std::span<Ret> out, bool showError, bool parallel) {
+            if (out.size() != receivers.size()) {
+                std::cerr << errorMsgPrefix << "Error: output column of " << out.size() << " values for " << receivers.size() << " receivers" << std::endl;
+                return false;
             }
-            void* ptr = instance.GetRawPtr();
-            std::function<void*(void*)> conv = [](void* orig) { return orig; };
-            auto* info = SafeGetMethodWithInherit(&conv, instance.GetType(), method, list, showError);
-            ptr = conv(ptr);
-            if (info == nullptr || info->name == "") {
-                return SharedObject();
+            return RawInvokeBatch(method, receivers, argColumns, TypeID::get<Ret>(), out.data(), [](void* column, size_t i, void* value) {
+                ((Ret*)column)[i] = *(Ret*)value;
+            }, showError, parallel);
+        }
+        bool InvokeRange(MemberName method, std::span<const ObjectPtr> receivers, ArgColumns argColumns, TypeID retType, void* column, void (*store)(void*, size_t, void*), size_t begin, size_t end, bool showError);
+    public:
+        template<typename T = ObjectPtr, typename U> requires (!std::is_function_v<T>)
+        SharedObject Invoke(U instance, MemberName method, const std::vector<T>& params, bool showError = true) {
+            ObjectPtr self{ instance.GetType(), instance.GetRawPtr() };
+            if constexpr (std::is_same<T, ObjectPtr>()) {
+                return Call(self, method, params, showError);
+            } else {
+                SmallBuffer<ObjectPtr> args(params.begin(), params.end());
+                return Call(self, method, args, showError);
             }
-            std::vector<std::shared_ptr<void>> temp;
-            auto ret = info->newRet();
-            info->getRegister(ptr, ConvertParams(params, *info, temp), ret);
-            if (ret.GetType().getHash() == TypeID::get<Any>().getHash()) {
-                return ret.template As<Any>().ToSharedPtr();
+        }
+        template<typename T = ObjectPtr> requires (!std::is_function_v<T>)
+        SharedObject InvokeStatic(TypeID type, MemberName method, const std::vector<T>& params, bool showError = true) {
+            if constexpr (std::is_same<T, ObjectPtr>()) {
+                return CallStatic(type, method, params, showError);
+            } else {
+                SmallBuffer<ObjectPtr> args(params.begin(), params.end());
+                return CallStatic(type, method, args, showError);
             }
-            return ret;
         }
-        template<typename T = ObjectPtr>
-        SharedObject InvokeStatic(TypeID type, std::string_view method, const std::vector<T>& params, bool showError = true) {
-            ArgsTypeList list;
-            for (auto param : params) {
-                list.push_back(param.GetType());
+        template<typename Sig>
+        TypedMethod<Sig> GetTypedMethod(TypeID type, MemberName member, bool showError = true) {
+            TypedMethod<Sig> method;
+            ReadGuard guard;
+            if (auto* call = FindTypedCall(&method.adjust, type, member, TypeID::get<Sig>(), showError)) {
+                method.call = *call;
+                method.pin = Pin();
             }
-            std::function<void*(void*)> conv = [](void* orig) { return orig; };
-            auto* info = SafeGetMethodWithInherit(&conv, type, method, list, showError);
-            if (info == nullptr) {
-                return SharedObject();
+            return method;
+        }
+        template<typename Sig, typename U, typename... Args> requires std::is_function_v<Sig>
+        auto Invoke(U instance, MemberName method, Args&&... args) {
+            ThisAdjust adjust;
+            ReadGuard guard;
+            auto* call = FindTypedCall(&adjust, instance.GetType(), method, TypeID::get<Sig>(), true);
+            if (call == nullptr) {
+                return TypedMethod<Sig>::Missing();
             }
-            std::vector<std::shared_ptr<void>> temp;
-            auto ret = info->newRet();
-            info->getRegister(nullptr, ConvertParams(params, *info, temp), ret);
-            if (ret.GetType().getHash() == TypeID::get<Any>().getHash()) {
-                return ret.template As<Any>().ToSharedPtr();
+            return TypedMethod<Sig>::Apply(*call, adjust(instance.GetRawPtr()), std::forward<Args>(args)...);
+        }
+        template<typename Sig, typename... Args> requires std::is_function_v<Sig>
+        auto InvokeStatic(TypeID type, MemberName method, Args&&... args) {
+            ThisAdjust adjust;
+            ReadGuard guard;
+            auto* call = FindTypedCall(&adjust, type, method, TypeID::get<Sig>(), true);
+            if (call == nullptr) {
+                return TypedMethod<Sig>::Missing();
             }
-            return ret;
+            return TypedMethod<Sig>::Apply(*call, nullptr, std::forward<Args>(args)...);
         }
         template<typename D, typename B>
         void SetInheritance() {
+            WriteBatch batch;
             ClassInfo& info = classInfo[TypeID::get<D>()];
+            version++;
             info.parents.push_back(TypeID::get<B>());
-            info.cast.push_back([](void* derived) -> void* {
-                return (B*)((D*)derived);
-            });
+            InheritHooks(TypeID::get<D>(), TypeID::get<B>());
+            if constexpr (requires(B* base) { static_cast<D*>(base); }) {
+                D* derived = OffsetProbe<D>();
+                info.cast.push_back({ reinterpret_cast<char*>(static_cast<B*>(derived)) - reinterpret_cast<char*>(derived) });
+            } else {
+                info.cast.push_back({ 0, [](void* derived) -> void* {
+                    return (B*)((D*)derived);
+                }});
+            }
         }
         template<typename D, typename B, typename R, typename... Args>
         void SetInheritance() {
@@ -414,21 +753,30 @@ class ReflMgr {
         bool IsBaseClass(TypeID query, TypeID base);
         template<typename T>
         void AddClass(TagList tagList = {}) {
+            WriteBatch batch;
             auto type = TypeID::get<T>();
             classInfo[type].newObject = [](const std::vector<ObjectPtr>& args) -> SharedObject {
-                auto obj = SharedObject{TypeID::get<T>(), std::make_shared<T>(), false};
+                auto obj = SharedObject{TypeID::get<T>(), std::allocate_shared<T>(ObjectAllocator<T>()), false};
                 obj.ctor(args);
                 return obj;
             };
             classInfo[type].tags = tagList;
+            RecordHooks(type);
+            version++;
         }
         void AddAliasClass(std::string_view from, std::string_view to);
         void AddVirtualClass(std::string_view cls, std::function<SharedObject(const std::vector<ObjectPtr>&)> ctor, TagList tagList = {});
         void AddVirtualInheritance(std::string_view cls, std::string_view inherit);
-        TagList& GetClassTag(TypeID cls);
-        TagList& GetFieldTag(TypeID cls, std::string_view name);
-        TagList& GetMethodInfo(TypeID cls, std::string_view name);
-        TagList& GetMethodInfo(TypeID cls, std::string_view name, const ArgsTypeList& args);
+        // tags are read through the current snapshot and returned as const
+        // copies, so code that used to edit them in place no longer compiles;
+        // changing them goes through the Set functions, which publish
+        const TagList GetClassTag(TypeID cls);
+        const TagList GetFieldTag(TypeID cls, std::string_view name);
+        const TagList GetMethodInfo(TypeID cls, std::string_view name);
+        const TagList GetMethodInfo(TypeID cls, std::string_view name, const ArgsTypeList& args);
+        void SetClassTag(TypeID cls, TagList tags);
+        void SetFieldTag(TypeID cls, std::string_view name, TagList tags);
+        void SetMethodTag(TypeID cls, std::string_view name, const ArgsTypeList& args, TagList tags);
     public:
         void IterateField(TypeID cls, std::function<void(const FieldInfo&)> callback);
         void IterateMethod(TypeID cls, std::function<void(const MethodInfo&)> callback);
@@ -223,8 +223,8 @@ namespace ReflMgrTool {
         mgr.SelfExport();
         // ObjectPtr SharedObject
 #define DEFOBJ(Obj)                                                  \
-        mgr.AddMethod(&Obj::Invoke, "Invoke");                       \
-        mgr.AddMethod(&Obj::GetField, "GetField");                   \
+        mgr.AddMethod(ConstMethodType<SharedObject, Obj, std::string_view, const std::vector<ObjectPtr>&>::Type(&Obj::Invoke), "Invoke"); \
+        mgr.AddMethod(ConstMethodType<ObjectPtr, Obj, std::string_view>::Type(&Obj::GetField), "GetField"); \
         mgr.AddMethod(&Obj::GetType, "GetType");                     \
         mgr.AddMethod(&Obj::tostring, "tostring");                   \
         mgr.AddMethod(&Obj::ctor, "ctor");                           \
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// Growable array that keeps its first N elements on the stack. Used as
+// scratch space by the invoke path so that calls with at most N arguments
+// do not touch the heap.
+template<typename T, size_t N = 8>
+class SmallBuffer {
+    private:
+        alignas(T) unsigned char local[N * sizeof(T)];
+        T* ptr = (T*)local;
+        size_t count = 0;
+        size_t capacity = N;
+        void Grow() {
+            T* next = (T*)::operator new(capacity * 2 * sizeof(T));
+            for (size_t i = 0; i < count; i++) {
+                new (next + i) T(std::move(ptr[i]));
+                ptr[i].~T();
+            }
+            if (ptr != (T*)local) {
+                ::operator delete(ptr);
+            }
+            ptr = next;
+            capacity *= 2;
+        }
+    public:
+        SmallBuffer() = default;
+        SmallBuffer(const SmallBuffer&) = delete;
+        SmallBuffer& operator = (const SmallBuffer&) = delete;
+        template<typename It>
+        SmallBuffer(It first, It last) {
+            for (; first != last; ++first) {
+                emplace_back(*first);
+            }
+        }
+        ~SmallBuffer() {
+            for (size_t i = 0; i < count; i++) {
+                ptr[i].~T();
+            }
+            if (ptr != (T*)local) {
+                ::operator delete(ptr);
+            }
+        }
+        void reserve(size_t n) {
+            while (capacity < n) {
+                Grow();
+            }
+        }
+        void clear() {
+            for (size_t i = 0; i < count; i++) {
+                ptr[i].~T();
+            }
+            count = 0;
+        }
+        template<typename... Args>
+        T& emplace_back(Args&&... args) {
+            if (count == capacity) {
+                Grow();
+            }
+            return *new (ptr + count++) T(std::forward<Args>(args)...);
+        }
+        void push_back(const T& val) {
+            emplace_back(val);
+        }
+        T& back() {
+            return ptr[count - 1];
+        }
+        T& operator [] (size_t i) {
+            return ptr[i];
+        }
+        const T& operator [] (size_t i) const {
+            return ptr[i];
+        }
+        T* data() {
+            return ptr;
+        }
+        const T* data() const {
+            return ptr;
+        }
+        size_t size() const {
+            return count;
+        }
+        bool empty() const {
+            return count == 0;
+        }
+        T* begin() {
+            return ptr;
+        }
+        T* end() {
+            return ptr + count;
+        }
+        const T* begin() const {
+            return ptr;
+        }
+        const T* end() const {
+            return ptr + count;
+        }
+};
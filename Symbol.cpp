@@ -0,0 +1,106 @@
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include "Symbol.h"
+
+// Names are interned from registration code and looked up from any thread,
+// so lookups probe an open-addressing index without locking. Writers insert
+// under a mutex; when the index grows, the old one is kept alive because a
+// reader may still be probing it.
+struct Symbol::Table {
+    struct Index {
+        size_t mask;
+        std::unique_ptr<std::atomic<const Entry*>[]> slots;
+        Index(size_t capacity) : mask(capacity - 1), slots(new std::atomic<const Entry*>[capacity]) {
+            for (size_t i = 0; i < capacity; i++) {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        const Entry* find(std::string_view name, size_t hash) const {
+            for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+                const Entry* entry = slots[i].load(std::memory_order_acquire);
+                if (entry == nullptr || (entry->hash == hash && entry->name == name)) {
+                    return entry;
+                }
+            }
+        }
+        void insert(const Entry* entry) {
+            size_t i = entry->hash & mask;
+            while (slots[i].load(std::memory_order_relaxed) != nullptr) {
+                i = (i + 1) & mask;
+            }
+            slots[i].store(entry, std::memory_order_release);
+        }
+    };
+    std::mutex mutex;
+    std::deque<Entry> entries;
+    std::deque<Index> indices;
+    std::atomic<const Index*> index;
+    Table() {
+        index.store(&indices.emplace_back(256));
+    }
+};
+
+Symbol::Table& Symbol::table() {
+    static Table instance;
+    return instance;
+}
+
+Symbol Symbol::intern(std::string_view name) {
+    auto& tbl = table();
+    size_t hash = hashOf(name);
+    std::lock_guard<std::mutex> lock(tbl.mutex);
+    const Table::Index* index = tbl.index.load(std::memory_order_relaxed);
+    if (const Entry* entry = index->find(name, hash)) {
+        return Symbol(entry);
+    }
+    tbl.entries.push_back({ std::string{name}, hash, (unsigned)tbl.entries.size() + 1 });
+    const Entry* entry = &tbl.entries.back();
+    if (tbl.entries.size() * 2 > index->mask + 1) {
+        auto& grown = tbl.indices.emplace_back((index->mask + 1) * 2);
+        for (auto& old : tbl.entries) {
+            grown.insert(&old);
+        }
+        tbl.index.store(&grown, std::memory_order_release);
+    } else {
+        const_cast<Table::Index*>(index)->insert(entry);
+    }
+    return Symbol(entry);
+}
+
+Symbol Symbol::find(std::string_view name) {
+    return Symbol(table().index.load(std::memory_order_acquire)->find(name, hashOf(name)));
+}
+
+size_t Symbol::hashOf(std::string_view name) {
+    return std::hash<std::string_view>()(name);
+}
+
+bool Symbol::isNull() const {
+    return entry == nullptr;
+}
+
+unsigned Symbol::getID() const {
+    return entry == nullptr ? 0 : entry->id;
+}
+
+size_t Symbol::getHash() const {
+    return entry == nullptr ? 0 : entry->hash;
+}
+
+std::string_view Symbol::getName() const {
+    return entry == nullptr ? std::string_view{} : std::string_view{entry->name};
+}
+
+bool Symbol::operator == (const Symbol& other) const {
+    return entry == other.entry;
+}
+
+bool Symbol::operator != (const Symbol& other) const {
+    return entry != other.entry;
+}
+
+size_t std::hash<Symbol>::operator() (const Symbol& sym) const {
+    return sym.getHash();
+}
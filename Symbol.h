@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class Symbol {
+    private:
+        struct Entry {
+            std::string name;
+            size_t hash;
+            unsigned id;
+        };
+        struct Table;
+        static Table& table();
+        const Entry* entry;
+        explicit Symbol(const Entry* entry) : entry(entry) {}
+    public:
+        Symbol() : entry(nullptr) {}
+        static Symbol intern(std::string_view name);
+        static Symbol find(std::string_view name);
+        static size_t hashOf(std::string_view name);
+        bool isNull() const;
+        unsigned getID() const;
+        size_t getHash() const;
+        std::string_view getName() const;
+        bool operator == (const Symbol& other) const;
+        bool operator != (const Symbol& other) const;
+};
+
+namespace std {
+    template<> class hash<Symbol> {
+        public:
+            size_t operator () (const Symbol& sym) const;
+    };
+};
+
+struct SymbolHash {
+    using is_transparent = void;
+    size_t operator() (const Symbol& sym) const {
+        return sym.getHash();
+    }
+    size_t operator() (std::string_view name) const {
+        return Symbol::hashOf(name);
+    }
+};
+
+struct SymbolEqual {
+    using is_transparent = void;
+    bool operator() (const Symbol& lhs, const Symbol& rhs) const {
+        return lhs == rhs;
+    }
+    bool operator() (const Symbol& lhs, std::string_view rhs) const {
+        return lhs.getName() == rhs;
+    }
+    bool operator() (std::string_view lhs, const Symbol& rhs) const {
+        return lhs == rhs.getName();
+    }
+};
+
+template<typename T>
+using SymbolMap = std::unordered_map<Symbol, T, SymbolHash, SymbolEqual>;
+
+struct MemberName {
+    std::string_view name;
+    Symbol symbol;
+    MemberName(const char* name) : MemberName(std::string_view{name}) {}
+    MemberName(const std::string& name) : MemberName(std::string_view{name}) {}
+    MemberName(std::string_view name) : name(name), symbol(Symbol::find(name)) {}
+    MemberName(Symbol symbol) : name(symbol.getName()), symbol(symbol) {}
+};
@@ -43,6 +43,11 @@ struct MethodType {
     using Type = Ret (U::*)(Args...);
 };
 
+template<typename Ret, typename U, typename... Args>
+struct ConstMethodType {
+    using Type = Ret (U::*)(Args...) const;
+};
+
 template<typename Ret, typename... Args>
 struct FunctionType {
     using Type = Ret (*)(Args...);
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include "ThreadPool.h"
+
+// index of the queue owned by the current thread, -1 outside of the pool
+static thread_local size_t workerIndex = -1;
+
+ThreadPool::ThreadPool(size_t threads) : queues(std::max<size_t>(threads, 1)) {
+    for (size_t i = 0; i < queues.size(); i++) {
+        workers.emplace_back([this, i]() { Run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::Instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+size_t ThreadPool::Size() const {
+    return workers.size();
+}
+
+bool ThreadPool::Pop(size_t index, Task& task) {
+    auto& queue = queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    pending--;
+    return true;
+}
+
+bool ThreadPool::Steal(size_t index, Task& task) {
+    for (size_t i = 1; i <= queues.size(); i++) {
+        auto& queue = queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            pending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::Run(size_t index) {
+    workerIndex = index;
+    Task task;
+    while (true) {
+        if (Pop(index, task) || Steal(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return stop || pending > 0; });
+        if (stop) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::Submit(Task task) {
+    size_t index = workerIndex < queues.size() ? workerIndex : next++ % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[index].mutex);
+        queues[index].tasks.push_back(std::move(task));
+        pending++;
+    }
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    wake.notify_one();
+}
+
+bool ThreadPool::RunOne() {
+    Task task;
+    size_t index = workerIndex < queues.size() ? workerIndex : next % queues.size();
+    if ((workerIndex < queues.size() && Pop(index, task)) || Steal(index, task)) {
+        task();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, Trampoline<void(size_t, size_t)> body) {
+    grain = std::max<size_t>(grain, 1);
+    struct Range {
+        const Trampoline<void(size_t, size_t)>* body;
+        std::atomic<size_t>* remaining;
+        size_t begin, end;
+    };
+    std::vector<Range> ranges;
+    std::atomic<size_t> remaining = (count + grain - 1) / grain;
+    for (size_t begin = 0; begin < count; begin += grain) {
+        ranges.push_back({ &body, &remaining, begin, std::min(begin + grain, count) });
+    }
+    for (auto& range : ranges) {
+        Submit([range = &range]() {
+            (*range->body)(range->begin, range->end);
+            range->remaining->fetch_sub(1, std::memory_order_release);
+        });
+    }
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!RunOne()) {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Trampoline.h"
+
+// Work-stealing pool used by the parallel batch APIs. Every worker owns a
+// queue and takes from its back; an idle worker (or a thread waiting in
+// ParallelFor) steals from the front of the others.
+class ThreadPool {
+    public:
+        using Task = Trampoline<void()>;
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+        std::vector<Queue> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> pending = 0;
+        std::atomic<size_t> next = 0;
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+        bool stop = false;
+        bool Pop(size_t index, Task& task);
+        bool Steal(size_t index, Task& task);
+        void Run(size_t index);
+    public:
+        explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator = (const ThreadPool&) = delete;
+        static ThreadPool& Instance();
+        size_t Size() const;
+        void Submit(Task task);
+        // runs one queued task on the calling thread, false if none was found
+        bool RunOne();
+        // calls body(begin, end) for consecutive ranges of at most grain items
+        // and returns once all of them are done; the caller takes part
+        void ParallelFor(size_t count, size_t grain, Trampoline<void(size_t, size_t)> body);
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Non-allocating replacement for std::function used by the registry. A
+// callable that is trivially copyable and small enough (a lambda capturing a
+// member or function pointer) is kept inline and invoked through a single
+// function pointer; anything else is shared through a heap copy.
+template<typename Sig>
+class Trampoline;
+
+template<typename Ret, typename... Args>
+class Trampoline<Ret(Args...)> {
+    public:
+        static constexpr size_t Capacity = 4 * sizeof(void*);
+    private:
+        Ret (*invoke)(const Trampoline&, Args...) = nullptr;
+        alignas(void*) unsigned char storage[Capacity] = {};
+        std::shared_ptr<const void> object;
+        template<typename F>
+        static constexpr bool Inline = std::is_trivially_copyable_v<F> && sizeof(F) <= Capacity && alignof(F) <= alignof(void*);
+        template<typename F>
+        static Ret InvokeInline(const Trampoline& self, Args... args) {
+            return (*(const F*)self.storage)(std::forward<Args>(args)...);
+        }
+        template<typename F>
+        static Ret InvokeShared(const Trampoline& self, Args... args) {
+            return (*(const F*)self.object.get())(std::forward<Args>(args)...);
+        }
+    public:
+        Trampoline() = default;
+        Trampoline(std::nullptr_t) {}
+        template<typename F> requires (!std::is_same_v<std::remove_cvref_t<F>, Trampoline> && std::is_invocable_r_v<Ret, const std::remove_cvref_t<F>&, Args...>)
+        Trampoline(F&& func) {
+            using Func = std::remove_cvref_t<F>;
+            if constexpr (requires(const Func& f) { f == nullptr; }) {
+                if (func == nullptr) {
+                    return;
+                }
+            }
+            if constexpr (Inline<Func>) {
+                new (storage) Func(std::forward<F>(func));
+                invoke = &InvokeInline<Func>;
+            } else {
+                object = std::make_shared<const Func>(std::forward<F>(func));
+                invoke = &InvokeShared<Func>;
+            }
+        }
+        Ret operator () (Args... args) const {
+            return invoke(*this, std::forward<Args>(args)...);
+        }
+        explicit operator bool() const {
+            return invoke != nullptr;
+        }
+};
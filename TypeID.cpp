@@ -3,16 +3,7 @@
 #include <map>
 
 bool TypeID::canImplicitlyConvertTo(const TypeID& other) const {
-    int cnt = 0;
-    for (const auto& type : TypeID::implicitConvertList) {
-        if (type == this->hash) {
-            cnt++;
-        }
-        if (type == other.hash) {
-            cnt++;
-        }
-    }
-    return cnt == 2;
+    return numeric >= 0 && other.numeric >= 0;
 }
 
 bool TypeID::checkRefAndConst(const TypeID& other) const {
@@ -57,29 +48,35 @@ bool TypeID::operator < (const TypeID& other) const {
     DEF(orig, uint8_t), DEF(orig, uint16_t), DEF(orig, uint32_t), DEF(orig, uint64_t),  \
     DEF(orig, float), DEF(orig, double), DEF(orig, long double)
 
-#define DEF(t) TypeID::get<t>().getHash()
-
-const std::vector<size_t> TypeID::implicitConvertList = {
-    DEFLIST(DEF)
-};
-
-#undef DEF
+template<typename From, typename To>
+static void ConvertNumeric(const void* from, void* to) {
+    *(To*)to = (To)*(const From*)from;
+}
 
-#define DEF_SINGLE(orig, target) \
-    { TypeID::get<target>().getHash(), std::function([](void* instance) -> std::shared_ptr<void> { return std::make_shared<target>(*(orig*)instance); }) }
+#define DEF_SINGLE(orig, target) &ConvertNumeric<orig, target>
 
-#define DEF(type) \
-    { TypeID::get<type>().getHash(), { DEFLIST2(type, DEF_SINGLE) }}
+#define DEF(type) { DEFLIST2(type, DEF_SINGLE) }
 
-static const std::unordered_map<size_t, std::unordered_map<size_t, std::function<std::shared_ptr<void>(void*)>>> convertFunc = {
+static void (* const convertTable[TypeID::NumericCount][TypeID::NumericCount])(const void*, void*) = {
     DEFLIST(DEF)
 };
 
 #undef DEF_SINGLE
 #undef DEF
 
+int TypeID::numericIndex() const {
+    return numeric;
+}
+
+void* TypeID::implicitConvertInto(const void* instance, TypeID target, ConvertSlot& slot) const {
+    convertTable[numeric][target.numeric](instance, slot.data);
+    return slot.data;
+}
+
 std::shared_ptr<void> TypeID::implicitConvertInstance(void* instance, TypeID target) {
-    return (convertFunc.at(getHash()).at(target.getHash()))(instance);
+    auto slot = std::make_shared<ConvertSlot>();
+    implicitConvertInto(instance, target, *slot);
+    return slot;
 }
 
 size_t std::hash<TypeID>::operator() (const TypeID& id) const {
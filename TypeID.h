@@ -4,6 +4,7 @@
 #include <vector>
 #include <string_view>
 #include <memory>
+#include <cstdint>
 #include "TemplateUtils.h"
 
 class TypeID {
@@ -13,7 +14,7 @@ class TypeID {
         std::string_view name;
         bool is_ref;
         bool is_const;
-        static const std::vector<size_t> implicitConvertList;
+        signed char numeric;
         static constexpr size_t calculateHash(std::string_view s) {
             size_t hash = sizeof(size_t) == 8 ? 0xcbf29ce484222325 : 0x811c9dc5;
             const size_t prime = sizeof(size_t) == 8 ? 0x00000100000001b3 : 0x01000193;
@@ -43,12 +44,35 @@ class TypeID {
             return ret;
 #endif
         }
+        // dense index of the arithmetic types taking part in implicit
+        // conversion, in the order of the conversion matrix in TypeID.cpp
+        static constexpr signed char numericIndexOf(size_t hash) {
+            constexpr size_t list[] = {
+                calculateHash(TypeToString<int8_t>()), calculateHash(TypeToString<int16_t>()),
+                calculateHash(TypeToString<int32_t>()), calculateHash(TypeToString<int64_t>()),
+                calculateHash(TypeToString<uint8_t>()), calculateHash(TypeToString<uint16_t>()),
+                calculateHash(TypeToString<uint32_t>()), calculateHash(TypeToString<uint64_t>()),
+                calculateHash(TypeToString<float>()), calculateHash(TypeToString<double>()),
+                calculateHash(TypeToString<long double>())
+            };
+            for (signed char i = 0; i < NumericCount; i++) {
+                if (list[i] == hash) {
+                    return i;
+                }
+            }
+            return -1;
+        }
         bool canImplicitlyConvertTo(const TypeID& other) const;
         bool checkRefAndConst(const TypeID& other) const;
     public:
-        TypeID() : hash(0) {}
+        static constexpr int NumericCount = 11;
+        // stack storage large enough for any converted numeric argument
+        struct ConvertSlot {
+            alignas(long double) unsigned char data[sizeof(long double)];
+        };
+        TypeID() : hash(0), is_ref(false), is_const(false), numeric(-1) {}
         bool isNull() const;
-        constexpr TypeID(std::string_view showName, std::string_view trueName, bool is_ref, bool is_const) : hash(calculateHash(trueName)), name(showName), is_ref(is_ref), is_const(is_const) {}
+        constexpr TypeID(std::string_view showName, std::string_view trueName, bool is_ref, bool is_const) : hash(calculateHash(trueName)), name(showName), is_ref(is_ref), is_const(is_const), numeric(numericIndexOf(hash)) {}
         template<typename T>
         static constexpr TypeID get() {
             return TypeID(TypeToString<T>(), TypeToString<typename std::remove_const<typename std::remove_reference<T>::type>::type>(), std::is_reference<T>(), std::is_const<T>());
@@ -59,6 +83,8 @@ class TypeID {
         size_t getHash() const;
         std::string_view getName() const;
         bool canBeAppliedTo(const TypeID& other) const;
+        int numericIndex() const;
+        void* implicitConvertInto(const void* instance, TypeID target, ConvertSlot& slot) const;
         std::shared_ptr<void> implicitConvertInstance(void* instance, TypeID target);
         bool operator == (const TypeID& other) const;
         bool operator != (const TypeID& other) const;
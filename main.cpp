@@ -1,9 +1,14 @@
 #include <iostream>
 #include <functional>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include "ReflMgrInit.h"
 #include "ReflMgr.h"
 #include "JSON.h"
+#include "Batch.h"
 
 struct Adder {
     int p = 123;
@@ -166,6 +171,103 @@ void JSONTest() {
     std::cout << data << std::endl;
 }
 
+std::string jsonText(const JSON& data) {
+    std::stringstream ss;
+    ss << data;
+    return ss.str();
+}
+
+void JSONViewTest() {
+    ReflMgrTool::Init();
+    JSON::Init();
+    std::string text = "[\"plain\", \"a\\\"b\\\\c\\/d\\n\\t\", {\"k\\\"ey\": \"v\"}]";
+    std::string expect = jsonText(JSON(text));
+    JSON view = JSON::ParseView(text);
+    std::cout << expect << std::endl;
+    std::cout << (jsonText(JSON::Parse(text)) == expect) << (jsonText(view) == expect) << std::endl;
+    // printed strings are escaped again, so they read back the same
+    std::cout << (jsonText(JSON::Parse(expect)) == expect) << std::endl;
+    // truncated input reports an error and keeps what was read
+    for (std::string_view cut : { "[1, 2", "[\"abc", "{\"a\": 1", "[\"a\\" }) {
+        std::cout << jsonText(JSON::Parse(cut)) << " " << jsonText(JSON::ParseView(cut)) << std::endl;
+    }
+}
+
+void JSONIndexTest() {
+    ReflMgrTool::Init();
+    JSON::Init();
+    // escapes, quotes and brackets on both sides of each 64 byte block edge
+    int same = 0, total = 0;
+    for (int pad = 50; pad < 140; pad++) {
+        for (std::string_view tail : { "\\\"]\"", "\\\\\", [1]", "x\\\\\\\"\"", "\", {\"k\": [\"v\"]}" }) {
+            std::string text = "[\"" + std::string(pad, 'x') + std::string(tail) + "]";
+            std::string expect = jsonText(JSON::Parse(text));
+            same += jsonText(JSON::Parse(text, JSON::ParseMode::Indexed)) == expect;
+            same += jsonText(JSON::ParseView(text, JSON::ParseMode::Indexed)) == expect;
+            total += 2;
+        }
+    }
+    std::cout << same << "/" << total << std::endl;
+    std::string text = "{\"s\": \"" + std::string(100, 'y') + "\\n\", \"n\": [1, 2.5, -3]}";
+    std::cout << JSON::Parse(text, JSON::ParseMode::Indexed)["n"] << std::endl;
+    for (std::string_view cut : { "[1, 2", "[\"abc", "{\"a\": 1" }) {
+        std::cout << jsonText(JSON::Parse(cut, JSON::ParseMode::Indexed)) << std::endl;
+    }
+}
+
+void JSONNumberTest() {
+    ReflMgrTool::Init();
+    JSON::Init();
+    // int64_t while it fits, then uint64_t, then double
+    JSON data = JSON::Parse("[9223372036854775807, -9223372036854775808, 9223372036854775808, "
+        "18446744073709551615, 18446744073709551616, -9223372036854775809]");
+    std::cout << data << std::endl;
+    TypeID types[] = {
+        TypeID::get<int64_t>(), TypeID::get<int64_t>(), TypeID::get<uint64_t>(),
+        TypeID::get<uint64_t>(), TypeID::get<double>(), TypeID::get<double>()
+    };
+    for (int i = 0; i < 6; i++) {
+        std::cout << (data[i].content().GetType() == types[i]);
+    }
+    std::cout << std::endl;
+    std::cout << (data[0].content().Get<int64_t>() == INT64_MAX) << (data[1].content().Get<int64_t>() == INT64_MIN)
+        << (data[3].content().Get<uint64_t>() == UINT64_MAX) << std::endl;
+    // doubles print the shortest text that reads back to the same bits
+    int same = 0;
+    std::vector<double> values = { 0.1, 1.0 / 3, 1e300, 5e-324, 2.2250738585072014e-308, 123456789.123456789, -0.0, 1e21, 3.0 };
+    for (double d : values) {
+        std::string text = jsonText(JSON(SharedObject::New<double>(d)));
+        double back = JSON::Parse("[" + text + "]")[0].content().Get<double>();
+        same += memcmp(&back, &d, sizeof(d)) == 0;
+        std::cout << text << " ";
+    }
+    std::cout << std::endl << same << "/" << values.size() << std::endl;
+    // inf and nan are not JSON numbers, they stay words
+    std::cout << JSON::Parse("[-inf, nan, 1e999]") << std::endl;
+    JSON n = JSON::NewMap();
+    n["i"] = -7;
+    n.AddItem("f", JSON(SharedObject::New<float>(2.0f)));
+    std::cout << n["i"] << " " << n["f"] << std::endl;
+}
+
+void JSONDocumentTest() {
+    ReflMgrTool::Init();
+    JSON::Init();
+    std::string text = "[{\"a\": [1, -2, 18446744073709551615, 2.5e-3, true, null]}, \"" + std::string(80, 'x') +
+        "\\\"\", [[], {}], {\"k\\\\\": {\"s\": \"v\\n\"}}]";
+    JSON doc = JSON::ParseDocument(text);
+    std::cout << (doc.Node() != nullptr) << (jsonText(doc) == jsonText(JSON::Parse(text))) << std::endl;
+    std::cout << doc.VecSize() << " " << doc.HasKey(3) << " " << doc.HasKey(4) << std::endl;
+    // accessors that return references convert one level at a time
+    JSON& first = doc[0];
+    std::cout << (doc.Node() == nullptr) << (first.Node() != nullptr) << " " << first["a"] << std::endl;
+    first["a"][0] = 7;
+    std::cout << doc[0] << " " << doc[3]["k\\"]["s"] << std::endl;
+    for (std::string_view cut : { "[1, 2", "[\"abc", "{\"a\": 1", "[{\"a\": [1" }) {
+        std::cout << jsonText(JSON::ParseDocument(cut)) << std::endl;
+    }
+}
+
 void numberTest() {
     ReflMgr::Instance().AddStaticMethod(Namespace::Global.Type(), std::function(
         [](int i, double f, int size) {
@@ -181,6 +283,247 @@ void numberTest() {
     f((void*)&Namespace::Global, std::vector<void*>{&a, &b, &c}, ret);
 }
 
+void handleTest() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<P>();
+    mgr.SetInheritance<P, Adder, Test>();
+    mgr.AddMethod(&Adder::add, "add");
+    auto handle = mgr.GetMethodHandle(TypeID::get<P>(), "add", { TypeID::get<int>(), TypeID::get<size_t>() });
+    auto instance = mgr.New<P>();
+    for (int i = 0; i < 3; i++) {
+        handle.Invoke(instance, { SharedObject::New<int>(i), SharedObject::New<size_t>(i) });
+    }
+}
+
+void fieldHandleTest() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<P>();
+    mgr.SetInheritance<P, Adder, Test>();
+    mgr.AddField(&Test::val, "val");
+    auto val = mgr.GetFieldHandle(TypeID::get<P>(), "val"); // Test 基类的偏移已并入字段偏移
+    auto instance = mgr.New<P>();
+    val.Ref<std::string>(instance.GetRawPtr()) = "_handle";
+    std::cout << val.HasOffset() << " " << val.Get(instance) << " " << instance.As<P>().val << std::endl;
+}
+
+void gatherTest() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<Test2>();
+    mgr.AddField(&Test2::p, "p");
+    auto p = mgr.GetFieldHandle(TypeID::get<Test2>(), "p");
+    std::vector<Test2> objs(100);
+    std::vector<ObjectPtr> ptrs;
+    for (int i = 0; i < objs.size(); i++) {
+        objs[i].p = i;
+        ptrs.push_back({ TypeID::get<Test2>(), &objs[i] });
+    }
+    std::vector<int> values(objs.size());
+    GatherField<int>(p, objs.data(), sizeof(Test2), values); // 固定步长时使用 SIMD gather
+    for (auto& value : values) {
+        value *= 2;
+    }
+    ScatterField<int>(p, ptrs, values);
+    GatherField<int>(p, ptrs, values);
+    std::cout << values[1] << " " << values[99] << " " << objs[99].p << std::endl;
+    // objects without the field are reported and gathered as 0
+    Test other;
+    ptrs[0] = { TypeID::get<Test>(), &other };
+    std::cout << GatherField<int>(p, ptrs, values) << " " << values[0] << " " << values[1] << std::endl;
+}
+
+void inlineCacheTest() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<P>();
+    mgr.SetInheritance<P, Adder, Test>();
+    mgr.AddClass<Test2>();
+    mgr.AddMethod(&Adder::add, "add");
+    mgr.AddMethod(&Test2::add, "add");
+    SharedObject objs[] = { mgr.New<P>(), mgr.New<Test2>() };
+    InvokeCache cache{"add"};
+    for (int i = 0; i < 4; i++) {
+        objs[i % 2].Invoke(cache, { SharedObject::New<int>(i), SharedObject::New<int>(i) });
+    }
+    std::cout << "hits: " << cache.Hits() << ", misses: " << cache.Misses() << std::endl;
+}
+
+void symbolTest() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<Test2>();
+    mgr.AddField(&Test2::p, "p");
+    mgr.AddMethod(&Test2::add, "add");
+    static const Symbol sym_add = Symbol::intern("add");
+    static const Symbol sym_p = Symbol::intern("p");
+    auto instance = mgr.New<Test2>();
+    std::cout << instance.GetField(sym_p) << std::endl;
+    instance.Invoke(sym_add, { SharedObject::New<int>(1), SharedObject::New<int>(2) });
+}
+
+void typedTest() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<P>();
+    mgr.SetInheritance<P, Adder, Test>();
+    mgr.AddMethod(std::function([](Adder* self, int a, int b) { return self->p + a + b; }), "sum");
+    auto instance = mgr.New<P>();
+    std::cout << mgr.Invoke<int(int, int)>(instance, "sum", 1, 2) << std::endl;
+    auto sum = mgr.GetTypedMethod<int(int, int)>(TypeID::get<P>(), "sum"); // checked once
+    for (int i = 0; i < 3; i++) {
+        std::cout << sum(instance, i, i) << std::endl;
+    }
+}
+
+void freezeTest() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<P>();
+    mgr.SetInheritance<P, Adder, Test>();
+    mgr.AddMethod(&Adder::add, "add");
+    mgr.AddField(&Test::val, "val");
+    mgr.Freeze();
+    auto instance = mgr.New<P>();
+    std::cout << instance.GetField("val") << std::endl;
+    instance.Invoke("add", { SharedObject::New<int>(1), SharedObject::New<int>(2) });
+    mgr.AddMethod(&Test::test, "test"); // publishes a new snapshot
+    instance.Invoke("test");
+}
+
+struct Counter {
+    int value = 0;
+    int get(int delta) {
+        return value + delta;
+    }
+};
+
+void concurrencyTest() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<Counter>();
+    mgr.AddMethod(&Counter::get, "get");
+    mgr.Freeze();
+    std::atomic<bool> stop = false;
+    std::atomic<int> failed = 0;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&, t]() {
+            auto obj = mgr.New<Counter>();
+            obj.As<Counter>().value = t;
+            for (int i = 0; !stop; i++) {
+                if (obj.Invoke("get", { SharedObject::New<int>(i) }).As<int>() != t + i) {
+                    failed++;
+                }
+            }
+        });
+    }
+    std::thread writer([&]() {
+        for (int i = 0; i < 200; i++) {
+            ReflMgr::WriteBatch batch; // publish once per batch
+            mgr.AddMethod(std::function([i](Counter* self) { return self->value * i; }), "mul" + std::to_string(i));
+            mgr.AddField(&Counter::value, "value" + std::to_string(i));
+        }
+    });
+    writer.join();
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    auto obj = mgr.New<Counter>();
+    obj.As<Counter>().value = 3;
+    std::cout << failed << " " << obj.Invoke("mul199") << " " << obj.GetField("value199") << std::endl;
+}
+
+void concurrencyBenchmark() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<Counter>();
+    mgr.AddMethod(&Counter::get, "get");
+    mgr.Freeze();
+    const int count = 200000;
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&]() {
+                auto obj = mgr.New<Counter>();
+                for (int i = 0; i < count; i++) {
+                    obj.Invoke("get", { SharedObject::New<int>(i) });
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        std::cout << threads << " threads: " << threads * count / time.count() << " calls/s" << std::endl;
+    }
+}
+
+void trampolineBenchmark() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<Counter>();
+    mgr.AddMethod(&Counter::get, "get");
+    auto& trampoline = mgr.GetMethodHandle(TypeID::get<Counter>(), "get", { TypeID::get<int>() }).GetMethodInfo()->getRegister;
+    // the same thunk AddMethod generates, held the way it was before
+    std::function<MethodInfo::FuncType> function = [p = &Counter::get](void* instance, std::span<void* const> params, SharedObject& ret) {
+        ret.Emplace<int>(((Counter*)instance->*p)(*(int*)params[0]));
+    };
+    Counter counter;
+    const int count = 10000000;
+    auto run = [&](const char* name, const auto& call) {
+        SharedObject ret;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            void* params[] = { &i };
+            call(&counter, params, ret);
+        }
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": " << count / time.count() << " calls/s" << std::endl;
+    };
+    run("Trampoline", trampoline);
+    run("std::function", function);
+}
+
+void invokeBatchTest() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<Counter>();
+    mgr.AddMethod(&Counter::get, "get");
+    std::vector<Counter> counters(1000);
+    std::vector<size_t> deltas(counters.size());
+    std::vector<ObjectPtr> receivers, args;
+    for (int i = 0; i < counters.size(); i++) {
+        counters[i].value = i;
+        deltas[i] = i;
+        receivers.push_back({ TypeID::get<Counter>(), &counters[i] });
+        args.push_back({ TypeID::get<size_t>(), &deltas[i] });
+    }
+    std::span<const ObjectPtr> columns[] = { args };
+    std::vector<double> results(counters.size()); // size_t 参数与 double 结果各只解析一次转换
+    mgr.InvokeBatch<double>("get", receivers, columns, results);
+    std::cout << results[1] << " " << results[999] << std::endl;
+    std::vector<double> parallel(counters.size()); // 分块在线程池上执行，结果按下标写回
+    mgr.ParallelInvokeBatch<double>("get", receivers, columns, parallel);
+    std::cout << (parallel == results) << std::endl;
+}
+
+void arenaTest() {
+    ReflMgrTool::Init();
+    auto& mgr = ReflMgr::Instance();
+    mgr.AddClass<P>();
+    ObjectArena arena; // everything below is released together with the arena
+    for (int i = 0; i < 1000; i++) {
+        auto obj = mgr.New<P>();
+        auto str = SharedObject::New<std::string>("request");
+        obj.As<P>().val = str.Get<std::string>();
+    }
+    std::cout << (arena.Used() > 0) << std::endl;
+}
+
 struct Info {
     int x;
     int y;